@@ -59,6 +59,8 @@ ifneq ($(BOOT_STAGE), 3)
 CMN_CSRC += $(CMN_SRCDIR)/tftf.c
 CMN_CSRC += $(CMN_SRCDIR)/ffff.c
 CMN_CSRC += $(CMN_SRCDIR)/error.c
+CMN_CSRC += $(CMN_SRCDIR)/boot_profile.c
+CMN_CSRC += $(CMN_SRCDIR)/lz4.c
 endif
 
 CMN_CSRC += $(CMN_SRCDIR)/crypto.c
@@ -0,0 +1,62 @@
+##
+ # Copyright (c) 2015 Google Inc.
+ # All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions are met:
+ # 1. Redistributions of source code must retain the above copyright notice,
+ # this list of conditions and the following disclaimer.
+ # 2. Redistributions in binary form must reproduce the above copyright notice,
+ # this list of conditions and the following disclaimer in the documentation
+ # and/or other materials provided with the distribution.
+ # 3. Neither the name of the copyright holder nor the names of its
+ # contributors may be used to endorse or promote products derived from this
+ # software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ # AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ # THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ # OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ # WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ # OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ # ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ##
+
+ifneq ($(CONFIG_HOSTSIM),y)
+$(error "bootbench runs on the host, build it after ./configure hostsim")
+endif
+
+APP_SRCDIR = apps/$(APPLICATION)/src
+APP_INCLUDES = -I$(TOPDIR)/apps/$(APPLICATION)/inc
+
+APP_CSRC =  $(APP_SRCDIR)/start.c
+APP_CSRC += $(APP_SRCDIR)/phase.c
+APP_CSRC += $(APP_SRCDIR)/image.c
+APP_CSRC += $(APP_SRCDIR)/rsa_sign.c
+APP_CSRC += $(APP_SRCDIR)/peer.c
+APP_CSRC += $(APP_SRCDIR)/cfgdata.c
+APP_CSRC += $(APP_SRCDIR)/membench.c
+
+APP_ASRC =
+
+APP_CFLAGS = -DITERATIONS=$(ITERATIONS)
+# room for the largest FFFF tables, for all the code that handles them
+APP_CFLAGS += -DMAX_FFFF_HEADER_SIZE_SUPPORTED=32768
+# with chip_unipro_wait_event, which hostsim_set_wfi turns into the polling
+# of builds without it, to compare both
+APP_CFLAGS += -D_UNIPRO_WFI
+
+#
+# The time spent hashing and checking signatures is told apart from the rest
+# by wrapping the crypto entry points the loaders call (see phase.c)
+#
+BENCH_WRAPPED = hash_update hash_final verify_signature \
+                verify_signature_start verify_signature_step \
+                verify_signature_finish
+APP_LINKFLAGS = $(foreach f,$(BENCH_WRAPPED),-Wl,--wrap=$(f))
+
+MANIFEST = IID1-secondstage-fw
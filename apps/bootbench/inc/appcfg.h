@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __APPCFG_H
+#define __APPCFG_H
+
+/**
+ * Maximum CPorts used/supported
+ */
+#define CPORT_MAX  2
+
+#define GBBOOT_CPORT 1
+
+/**
+ * Where the results go, one CSV line per image and boot phase
+ */
+#define BOOTBENCH_RESULTS_FILE  "bootbench.csv"
+
+/**
+ * Where the cost per byte of memcpy, memset and memcmp goes, one CSV line per
+ * function, alignment and size
+ */
+#define BOOTBENCH_MEM_RESULTS_FILE  "bootbench_mem.csv"
+
+/**
+ * Budgets of the boot phases, on the host running the benchmark. A phase is
+ * over budget when its median over the iterations takes longer than
+ *     fixed + per_unit * units
+ * with the units being those of the phase: sections for the header parse
+ * (elements, with budgets of their own, for the FFFF tables), bytes for
+ * hashing and transfer, signatures for the verification (whose fixed part
+ * pays for the verify_signature_step calls made while waiting on Greybus).
+ * They are loose on purpose: they are there to catch a change that makes a
+ * phase several times slower, not to compare hosts. Override them with
+ * APP_CFLAGS if need be.
+ */
+#ifndef BOOTBENCH_BUDGET_PARSE_NS
+#define BOOTBENCH_BUDGET_PARSE_NS               20000
+#endif
+#ifndef BOOTBENCH_BUDGET_PARSE_NS_PER_SECTION
+#define BOOTBENCH_BUDGET_PARSE_NS_PER_SECTION   1000
+#endif
+#ifndef BOOTBENCH_BUDGET_HASH_NS
+#define BOOTBENCH_BUDGET_HASH_NS                20000
+#endif
+#ifndef BOOTBENCH_BUDGET_HASH_NS_PER_BYTE
+#define BOOTBENCH_BUDGET_HASH_NS_PER_BYTE       40
+#endif
+#ifndef BOOTBENCH_BUDGET_VERIFY_NS
+#define BOOTBENCH_BUDGET_VERIFY_NS              100000
+#endif
+#ifndef BOOTBENCH_BUDGET_VERIFY_NS_PER_SIGNATURE
+#define BOOTBENCH_BUDGET_VERIFY_NS_PER_SIGNATURE 2000000
+#endif
+#ifndef BOOTBENCH_BUDGET_FFFF_NS
+#define BOOTBENCH_BUDGET_FFFF_NS                20000
+#endif
+#ifndef BOOTBENCH_BUDGET_FFFF_NS_PER_ELEMENT
+#define BOOTBENCH_BUDGET_FFFF_NS_PER_ELEMENT    1000
+#endif
+#ifndef BOOTBENCH_BUDGET_TRANSFER_NS
+#define BOOTBENCH_BUDGET_TRANSFER_NS            100000
+#endif
+#ifndef BOOTBENCH_BUDGET_TRANSFER_NS_PER_BYTE
+#define BOOTBENCH_BUDGET_TRANSFER_NS_PER_BYTE   4
+#endif
+
+/**
+ * Time the AP takes to answer, for the comparison of waiting for Greybus
+ * responses in WFI and by polling, and what waking up may cost on top of it
+ * for each request
+ */
+#ifndef BOOTBENCH_PEER_LATENCY_NS
+#define BOOTBENCH_PEER_LATENCY_NS               50000
+#endif
+#ifndef BOOTBENCH_BUDGET_WAKE_NS
+#define BOOTBENCH_BUDGET_WAKE_NS                500000
+#endif
+
+#endif /* __APPCFG_H */
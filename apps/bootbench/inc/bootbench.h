@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __BOOTBENCH_H
+#define __BOOTBENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "crypto.h"
+#include "data_loading.h"
+
+/*
+ * The boot phases the time of an image load is split into. Time spent in a
+ * phase nested in another (e.g. hashing from within a transfer) only counts
+ * for the inner one.
+ */
+typedef enum {
+    BENCH_PHASE_PARSE,      /* FFFF/TFTF header parsing, and all the rest */
+    BENCH_PHASE_HASH,
+    BENCH_PHASE_VERIFY,     /* RSA signature verification */
+    BENCH_PHASE_TRANSFER,   /* data_load_ops calls, SPI or Greybus */
+    NUMBER_OF_BENCH_PHASES
+} bench_phase;
+
+typedef struct {
+    uint64_t ns[NUMBER_OF_BENCH_PHASES];
+    uint64_t instructions[NUMBER_OF_BENCH_PHASES];
+} bench_sample;
+
+/**
+ * @brief Get the time
+ * @return CLOCK_MONOTONIC, in ns
+ */
+uint64_t bench_ns(void);
+
+/**
+ * @brief Open a counter of a hardware event in user mode, for this thread
+ * @param config the event, a PERF_COUNT_HW_*
+ * @return the counter, for bench_counter_read, or <0 if there is no access
+ *         to it
+ */
+int bench_counter_open(uint64_t config);
+
+/**
+ * @brief Read a counter opened by bench_counter_open
+ * @param fd the counter
+ * @return its count, 0 if fd is <0
+ */
+uint64_t bench_counter_read(int fd);
+
+/**
+ * @brief qsort comparison of uint64_t's, in increasing order
+ */
+int bench_compare_u64(const void *a, const void *b);
+
+/**
+ * @brief Set up the phase accounting
+ * @return true if instructions are counted, false if only time is
+ */
+bool bench_phase_init(void);
+
+/**
+ * @brief Start accounting time to sample, in BENCH_PHASE_PARSE
+ * @param sample where to add the time and instructions of the phases
+ */
+void bench_phase_start(bench_sample *sample);
+
+/**
+ * @brief Stop the accounting started by bench_phase_start
+ */
+void bench_phase_stop(void);
+
+/**
+ * @brief Enter a phase, until the matching bench_phase_leave
+ * @param phase the phase entered
+ */
+void bench_phase_enter(bench_phase phase);
+
+/**
+ * @brief Leave the phase entered last
+ */
+void bench_phase_leave(void);
+
+/**
+ * @brief Get data_load_ops that account their calls as transfer time
+ * @param ops the data_load_ops to wrap
+ * @return the wrapping data_load_ops, valid until the next call
+ */
+data_load_ops *bench_timed_ops(data_load_ops *ops);
+
+/* the crypto functions behind the phase.c wrappers, see Sources.mk */
+void __real_hash_update(unsigned char *data, uint32_t datalen);
+void __real_hash_final(unsigned char *digest);
+
+typedef struct {
+    uint32_t payload_size;      /* bytes of section data */
+    uint32_t number_of_sections;
+    bool is_signed;
+} bench_image_params;
+
+typedef struct {
+    uint8_t *flash;             /* SPI flash image, FFFF header included */
+    uint32_t flash_size;
+    uint8_t *tftf;              /* the stage 3 TFTF within flash, if any */
+    uint32_t tftf_size;
+    uint32_t hashed_size;       /* bytes hashed when the TFTF is loaded */
+} bench_image;
+
+/**
+ * @brief Generate an image: an FFFF with a stage 3 TFTF in it
+ * @param params what the image is made of
+ * @param image the generated image, to be freed with bench_image_free
+ * @return 0 on success, <0 on error
+ */
+int bench_image_build(const bench_image_params *params, bench_image *image);
+
+/**
+ * @brief Generate a flash image holding an FFFF table only
+ *
+ * The elements are laid out in shuffled order, and are not in the image:
+ * it is there to time locate_ffff_element_on_storage.
+ *
+ * @param number_of_elements the number of elements in the table
+ * @param image the generated image, to be freed with bench_image_free
+ * @return 0 on success, <0 on error
+ */
+int bench_ffff_table_build(uint32_t number_of_elements, bench_image *image);
+
+/**
+ * @brief Free an image made by bench_image_build or bench_ffff_table_build
+ * @param image the image
+ */
+void bench_image_free(bench_image *image);
+
+/**
+ * @brief Time memcpy, memset and memcmp, and report their cost per byte
+ *
+ * These are the utils.c functions (hostsim builds with -fno-builtin), for
+ * the sizes and alignments the loaders use them with.
+ */
+void bench_mem(void);
+
+/* name of the test key the images are signed with */
+#define BENCH_KEY_NAME  "bootbench test key"
+
+/**
+ * @brief Get the public half of the test key
+ * @param key where to store the public key
+ * @param mont where to store its precomputed Montgomery constants
+ */
+void bench_rsa_public_key(crypto_public_key *key,
+                          crypto_public_key_mont *mont);
+
+/**
+ * @brief Sign a digest with the test key (RSA2048, PKCS#1 v1.5, SHA256)
+ * @param digest SHA256 digest of the signed data
+ * @param signature where to store the signature, big-endian
+ */
+void bench_rsa_sign(const unsigned char digest[SHA256_HASH_DIGEST_SIZE],
+                    unsigned char signature[RSA2048_PUBLIC_KEY_SIZE]);
+
+/**
+ * @brief Fill in the second stage config data with the test key
+ */
+void bench_cfgdata_init(void);
+
+/**
+ * @brief Start serving an image over Greybus, from the far end of the link
+ *
+ * Queues the PROTOCOL_VERSION and AP_READY requests the AP would send, then
+ * answers the requests of greybus_ops.
+ *
+ * @param image the TFTF to serve
+ * @param size size of the TFTF
+ * @param chunk_size GB_MAX_PAYLOAD_SIZE or GB_LARGE_PAYLOAD_SIZE, the
+ *        largest GET_FIRMWARE chunk the client gets to ask for
+ */
+void bench_peer_start(const uint8_t *image, uint32_t size,
+                      uint32_t chunk_size);
+
+/**
+ * @brief Stop serving
+ * @return the status of the last READY_TO_BOOT request
+ */
+uint8_t bench_peer_stop(void);
+
+#endif /* __BOOTBENCH_H */
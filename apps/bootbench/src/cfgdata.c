@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "2ndstage_cfgdata.h"
+#include "bootbench.h"
+
+/*
+ * The config data has the layout the second stage finds in its .s2lcfg
+ * section, laid out by the benchmark rather than by the image packager:
+ * one public key, followed by its Montgomery constants.
+ */
+static uint8_t s2l_buf[S2LCFG_MAX_SIZE] __attribute__ ((aligned(4)));
+static uint32_t *number_of_keys_mont;
+static crypto_public_key_mont *keys_mont;
+
+/* Compile-time test hack to verify that all of it fits */
+typedef char ___bench_cfgdata_test[(offsetof(secondstage_cfgdata, public_keys) +
+                                    sizeof(crypto_public_key) +
+                                    sizeof(uint32_t) +
+                                    sizeof(crypto_public_key_mont) <=
+                                    S2LCFG_MAX_SIZE) ? 1 : -1];
+
+void bench_cfgdata_init(void) {
+    secondstage_cfgdata *cfgdata = (secondstage_cfgdata *)s2l_buf;
+    uint32_t offset;
+
+    memset(s2l_buf, 0, sizeof(s2l_buf));
+    memcpy(cfgdata->sentinel, secondstage_cfg_sentinel,
+           SECONDSTAGE_CFG_SENTINEL_SIZE);
+
+    offset = offsetof(secondstage_cfgdata, public_keys) +
+             sizeof(crypto_public_key);
+    number_of_keys_mont = (uint32_t *)&s2l_buf[offset];
+    keys_mont = (crypto_public_key_mont *)&s2l_buf[offset +
+                                                   sizeof(uint32_t)];
+
+    cfgdata->number_of_public_keys = 1;
+    *number_of_keys_mont = 1;
+    bench_rsa_public_key(&cfgdata->public_keys[0], &keys_mont[0]);
+}
+
+int get_2ndstage_cfgdata(secondstage_cfgdata **cfgdata) {
+    *cfgdata = (secondstage_cfgdata *)s2l_buf;
+
+    if (memcmp((*cfgdata)->sentinel,
+               secondstage_cfg_sentinel,
+               SECONDSTAGE_CFG_SENTINEL_SIZE)) {
+        return -1;
+    }
+    return 0;
+}
+
+const crypto_public_key_mont *
+get_2ndstage_cfgdata_key_mont(secondstage_cfgdata *cfgdata, uint32_t index) {
+    if (number_of_keys_mont == NULL || index >= *number_of_keys_mont) {
+        return NULL;
+    }
+    return &keys_mont[index];
+}
@@ -0,0 +1,321 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "chipdef.h"
+#include "crypto.h"
+#include "tftf.h"
+#include "ffff.h"
+#include "bootbench.h"
+
+/* FFFF layout: two headers, then the TFTF element */
+#define BENCH_FFFF_HEADER_SIZE      FFFF_HEADER_SIZE_MIN
+#define BENCH_FFFF_ERASE_BLOCK_SIZE 4096
+#define BENCH_FFFF_ELEMENT_LOCATION (2 * BENCH_FFFF_ERASE_BLOCK_SIZE)
+/* the w25q16dw of the bridged SPI */
+#define BENCH_FLASH_CAPACITY        (2 * 1024 * 1024)
+
+#define ROUND_UP(x, a)  (((x) + (a) - 1) / (a) * (a))
+
+/**
+ * @brief Fill a buffer with pseudo random data, the same for every run
+ */
+static void fill_pseudo_random(uint8_t *buf, uint32_t len, uint32_t seed) {
+    uint32_t x = seed | 1;
+
+    while (len--) {
+        /* xorshift32 */
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        *buf++ = x;
+    }
+}
+
+/**
+ * @brief Smallest TFTF header size with room for a number of sections
+ *
+ * The end-of-table marker is one of the sections, and the last slot of the
+ * header can't be used (see is_section_out_of_range).
+ */
+static uint32_t tftf_header_size(uint32_t number_of_sections) {
+    uint32_t size = TFTF_HEADER_SIZE_MIN;
+    uint32_t needed = offsetof(tftf_header, sections) +
+                      (number_of_sections + 1) *
+                      sizeof(tftf_section_descriptor);
+
+    while (size < needed) {
+        size <<= 1;
+    }
+    return size;
+}
+
+/**
+ * @brief Fill in the fields of an FFFF header, sentinels included, but for
+ *        the elements
+ */
+static void init_ffff_header(ffff_header *header, uint32_t header_size,
+                             uint32_t flash_capacity,
+                             uint32_t flash_image_length) {
+    memset(header, 0, header_size);
+    memcpy(header->sentinel_value, ffff_sentinel_value, FFFF_SENTINEL_SIZE);
+    memcpy(header->build_timestamp, "20151016-000000", FFFF_TIMESTAMP_SIZE);
+    snprintf(header->flash_image_name, sizeof(header->flash_image_name),
+             "bootbench");
+    header->flash_capacity = flash_capacity;
+    header->erase_block_size = BENCH_FFFF_ERASE_BLOCK_SIZE;
+    header->header_size = header_size;
+    header->flash_image_length = flash_image_length;
+    header->header_generation = 1;
+
+    memcpy(get_trailing_sentinel_addr(header), ffff_sentinel_value,
+           FFFF_SENTINEL_SIZE);
+}
+
+static void build_ffff(uint8_t *flash, uint32_t flash_size,
+                       uint32_t tftf_size) {
+    ffff_header *header = (ffff_header *)flash;
+
+    init_ffff_header(header, BENCH_FFFF_HEADER_SIZE, BENCH_FLASH_CAPACITY,
+                     flash_size);
+
+    header->elements[0].element_type = FFFF_ELEMENT_STAGE_3_FW;
+    header->elements[0].element_id = 1;
+    header->elements[0].element_length = tftf_size;
+    header->elements[0].element_location = BENCH_FFFF_ELEMENT_LOCATION;
+    header->elements[0].element_generation = 1;
+    header->elements[1].element_type = FFFF_ELEMENT_END;
+
+    /* and the second copy, one erase block further */
+    memcpy(flash + BENCH_FFFF_ERASE_BLOCK_SIZE, flash,
+           BENCH_FFFF_HEADER_SIZE);
+}
+
+/**
+ * @brief Sign a TFTF the way load_tftf_image checks it
+ *
+ * The signed data is the header up to the signature section descriptor,
+ * then the data of all the sections before it.
+ */
+static void sign_tftf(uint8_t *tftf, tftf_section_descriptor *signature_section,
+                      uint32_t signed_data_length, tftf_signature *signature) {
+    tftf_header *header = (tftf_header *)tftf;
+    unsigned char digest[SHA256_HASH_DIGEST_SIZE];
+    uint32_t header_hash_len = (uint8_t *)signature_section - tftf;
+
+    hash_start();
+    __real_hash_update(tftf, header_hash_len);
+    __real_hash_update(tftf + header->header_size, signed_data_length);
+    __real_hash_final(digest);
+
+    memset(signature, 0, sizeof(*signature));
+    signature->length = sizeof(*signature);
+    signature->type = ALGORITHM_TYPE_RSA2048_SHA256;
+    memcpy(signature->key_name, BENCH_KEY_NAME, sizeof(BENCH_KEY_NAME));
+    bench_rsa_sign(digest, signature->signature);
+}
+
+int bench_image_build(const bench_image_params *params, bench_image *image) {
+    tftf_header *header;
+    tftf_section_descriptor *section;
+    uint32_t header_size;
+    uint32_t section_length;
+    uint32_t offset;
+    uint32_t i;
+
+    if (params->number_of_sections == 0 ||
+        params->payload_size < params->number_of_sections * sizeof(uint32_t)) {
+        return -1;
+    }
+
+    header_size = tftf_header_size(params->number_of_sections +
+                                   (params->is_signed ? 1 : 0) + 1);
+    if (header_size > MAX_TFTF_HEADER_SIZE_SUPPORTED) {
+        return -1;
+    }
+
+    image->tftf_size = header_size + params->payload_size;
+    if (params->is_signed) {
+        image->tftf_size += sizeof(tftf_signature);
+    }
+    image->flash_size = BENCH_FFFF_ELEMENT_LOCATION +
+                        ROUND_UP(image->tftf_size, BENCH_FFFF_ERASE_BLOCK_SIZE);
+    image->flash = calloc(1, image->flash_size);
+    if (image->flash == NULL) {
+        return -1;
+    }
+    image->tftf = image->flash + BENCH_FFFF_ELEMENT_LOCATION;
+    build_ffff(image->flash, image->flash_size, image->tftf_size);
+
+    header = (tftf_header *)image->tftf;
+    memcpy(header->sentinel_value, tftf_sentinel, TFTF_SENTINEL_SIZE);
+    header->header_size = header_size;
+    memcpy(header->build_timestamp, "20151016-000000", TFTF_TIMESTAMP_SIZE);
+    snprintf(header->firmware_package_name,
+             sizeof(header->firmware_package_name),
+             "bootbench-%u-%u%s", params->payload_size,
+             params->number_of_sections, params->is_signed ? "-signed" : "");
+    header->package_type = FFFF_ELEMENT_STAGE_3_FW;
+    /* Thumb entry point in the first section */
+    header->start_location = WORKRAM_BASE | 1;
+
+    /* equal sections, word aligned, back to back in workram */
+    section_length = (params->payload_size / params->number_of_sections) &
+                     ~(sizeof(uint32_t) - 1);
+    offset = 0;
+    section = &header->sections[0];
+    for (i = 0; i < params->number_of_sections; i++, section++) {
+        section->section_type = (i == 0) ? TFTF_SECTION_RAW_CODE :
+                                           TFTF_SECTION_RAW_DATA;
+        section->section_id = i;
+        section->section_length = (i + 1 < params->number_of_sections) ?
+                                  section_length :
+                                  params->payload_size - offset;
+        section->section_load_address = WORKRAM_BASE + offset;
+        section->section_expanded_length = section->section_length;
+        offset += section->section_length;
+    }
+    fill_pseudo_random(image->tftf + header_size, params->payload_size,
+                       params->payload_size ^ params->number_of_sections);
+
+    image->hashed_size = 0;
+    if (params->is_signed) {
+        section->section_type = TFTF_SECTION_SIGNATURE;
+        section->section_length = sizeof(tftf_signature);
+        section->section_load_address = DATA_ADDRESS_TO_BE_IGNORED;
+        section->section_expanded_length = sizeof(tftf_signature);
+        image->hashed_size = ((uint8_t *)section - image->tftf) +
+                             params->payload_size;
+        sign_tftf(image->tftf, section, params->payload_size,
+                  (tftf_signature *)(image->tftf + header_size +
+                                     params->payload_size));
+        section++;
+    }
+    section->section_type = TFTF_SECTION_END;
+
+    return 0;
+}
+
+int bench_ffff_table_build(uint32_t number_of_elements, bench_image *image) {
+    static const uint8_t element_types[] = {
+        FFFF_ELEMENT_STAGE_2_FW,
+        FFFF_ELEMENT_STAGE_3_FW,
+        FFFF_ELEMENT_IMS_CERT,
+        FFFF_ELEMENT_CMS_CERT,
+        FFFF_ELEMENT_DATA,
+    };
+    ffff_header *header;
+    ffff_element_descriptor *element;
+    uint32_t *slots;
+    uint32_t header_size = FFFF_HEADER_SIZE_MIN;
+    uint32_t second_header;
+    uint32_t first_element;
+    uint32_t flash_image_length;
+    uint32_t flash_capacity = BENCH_FLASH_CAPACITY;
+    uint32_t x = number_of_elements | 1;
+    uint32_t i, j, tmp;
+
+    /*
+     * The end-of-table marker is one of the elements, and the last slot of
+     * the header can't be used (see is_element_out_of_range).
+     */
+    while (header_size < offsetof(ffff_header, elements) +
+                         (number_of_elements + 2) *
+                         sizeof(ffff_element_descriptor) +
+                         FFFF_SENTINEL_SIZE) {
+        header_size <<= 1;
+    }
+    if (number_of_elements == 0 ||
+        header_size > MAX_FFFF_HEADER_SIZE_SUPPORTED) {
+        return -1;
+    }
+
+    second_header = (header_size > BENCH_FFFF_ERASE_BLOCK_SIZE) ?
+                    header_size : BENCH_FFFF_ERASE_BLOCK_SIZE;
+    first_element = second_header << 1;
+    flash_image_length = first_element +
+                         number_of_elements * BENCH_FFFF_ERASE_BLOCK_SIZE;
+    while (flash_capacity < flash_image_length) {
+        flash_capacity <<= 1;
+    }
+
+    /* only the headers are read, the elements are left out of the flash */
+    image->flash_size = second_header + header_size;
+    image->flash = calloc(1, image->flash_size);
+    slots = calloc(number_of_elements, sizeof(*slots));
+    if (image->flash == NULL || slots == NULL) {
+        free(image->flash);
+        free(slots);
+        return -1;
+    }
+    image->tftf = NULL;
+    image->tftf_size = 0;
+    image->hashed_size = 0;
+
+    /* one erase block each, in shuffled order (Fisher-Yates, xorshift32) */
+    for (i = 0; i < number_of_elements; i++) {
+        slots[i] = i;
+    }
+    for (i = number_of_elements - 1; i > 0; i--) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        j = x % (i + 1);
+        tmp = slots[i];
+        slots[i] = slots[j];
+        slots[j] = tmp;
+    }
+
+    header = (ffff_header *)image->flash;
+    init_ffff_header(header, header_size, flash_capacity, flash_image_length);
+    element = &header->elements[0];
+    for (i = 0; i < number_of_elements; i++, element++) {
+        element->element_type = element_types[i % sizeof(element_types)];
+        element->element_id = i;
+        element->element_length = BENCH_FFFF_ERASE_BLOCK_SIZE;
+        element->element_location = first_element +
+                                    slots[i] * BENCH_FFFF_ERASE_BLOCK_SIZE;
+        element->element_generation = 1;
+    }
+    element->element_type = FFFF_ELEMENT_END;
+    memcpy(image->flash + second_header, image->flash, header_size);
+
+    free(slots);
+    return 0;
+}
+
+void bench_image_free(bench_image *image) {
+    free(image->flash);
+    image->flash = NULL;
+    image->tftf = NULL;
+}
@@ -0,0 +1,188 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include "appcfg.h"
+#include "greybus.h"
+#include "utils.h"
+#include "bootbench.h"
+
+/*
+ * Cost per byte of the utils.c memcpy, memset and memcmp: a header, a SHA-256
+ * block, a section, and the 2KB and 8KB Greybus chunks, with the buffers
+ * word aligned, both off by one byte (head and tail bytewise, words in
+ * between), and off by one from each other (all bytewise for memcpy). memcmp
+ * only goes word by word when both buffers are word aligned.
+ */
+static const uint32_t mem_sizes[] = {
+    16, 64, 512, GB_MAX_PAYLOAD_SIZE, GB_LARGE_PAYLOAD_SIZE
+};
+
+static const struct {
+    const char *name;
+    uint32_t dest_offset;
+    uint32_t src_offset;
+} mem_alignments[] = {
+    {"aligned", 0, 0},
+    {"both+1", 1, 1},
+    {"dest+1", 1, 0},
+};
+
+/* bytes handled per sample, in as many calls as it takes */
+#define MEM_BYTES_PER_SAMPLE    (1024 * 1024)
+
+static uint8_t mem_dest[GB_LARGE_PAYLOAD_SIZE + 4] __attribute__ ((aligned(4)));
+static uint8_t mem_src[GB_LARGE_PAYLOAD_SIZE + 4] __attribute__ ((aligned(4)));
+
+/* where the memcmp results go, so that the calls are not optimized out */
+static volatile int mem_sink;
+
+static void mem_copy(uint8_t *dest, const uint8_t *src, size_t n) {
+    memcpy(dest, src, n);
+}
+
+static void mem_fill(uint8_t *dest, const uint8_t *src, size_t n) {
+    memset(dest, 0x5a, n);
+}
+
+static void mem_compare(uint8_t *dest, const uint8_t *src, size_t n) {
+    /* equal buffers, the worst case: all the bytes are looked at */
+    mem_sink += memcmp(dest, src, n);
+}
+
+static const struct {
+    const char *name;
+    void (*call)(uint8_t *dest, const uint8_t *src, size_t n);
+    bool has_src;
+} mem_functions[] = {
+    {"memcpy", mem_copy, true},
+    {"memset", mem_fill, false},
+    {"memcmp", mem_compare, true},
+};
+
+void bench_mem(void) {
+    uint64_t ns[ITERATIONS];
+    uint64_t cycles[ITERATIONS];
+    uint64_t start_ns, start_cycles;
+    uint64_t bytes;
+    uint32_t calls;
+    uint32_t function, alignment, size;
+    uint8_t *dest;
+    uint8_t *src;
+    FILE *results;
+    int cycles_fd;
+    int i;
+    uint32_t j;
+
+    cycles_fd = bench_counter_open(PERF_COUNT_HW_CPU_CYCLES);
+
+    results = fopen(BOOTBENCH_MEM_RESULTS_FILE, "w");
+    if (results == NULL) {
+        perror(BOOTBENCH_MEM_RESULTS_FILE);
+        return;
+    }
+    fprintf(results, "function,alignment,size,iterations,bytes,median_ns,"
+            "median_cycles,ns_per_byte,cycles_per_byte\n");
+
+    printf("bootbench: memory functions, cycles %s\n",
+           (cycles_fd >= 0) ? "counted" : "not counted (no PMU access)");
+
+    for (function = 0; function < ARRAY_SIZE(mem_functions); function++) {
+        for (alignment = 0; alignment < ARRAY_SIZE(mem_alignments);
+             alignment++) {
+            if (!mem_functions[function].has_src &&
+                mem_alignments[alignment].src_offset !=
+                    mem_alignments[alignment].dest_offset) {
+                /* same as both+1 */
+                continue;
+            }
+
+            for (size = 0; size < ARRAY_SIZE(mem_sizes); size++) {
+                dest = mem_dest + mem_alignments[alignment].dest_offset;
+                src = mem_src + mem_alignments[alignment].src_offset;
+                calls = MEM_BYTES_PER_SAMPLE / mem_sizes[size];
+                bytes = (uint64_t)calls * mem_sizes[size];
+                memset(mem_src, 0xa5, sizeof(mem_src));
+                memset(mem_dest, 0xa5, sizeof(mem_dest));
+
+                for (i = 0; i < ITERATIONS; i++) {
+                    start_cycles = bench_counter_read(cycles_fd);
+                    start_ns = bench_ns();
+                    for (j = 0; j < calls; j++) {
+                        mem_functions[function].call(dest, src,
+                                                     mem_sizes[size]);
+                    }
+                    ns[i] = bench_ns() - start_ns;
+                    cycles[i] = bench_counter_read(cycles_fd) - start_cycles;
+                }
+                qsort(ns, ITERATIONS, sizeof(ns[0]), bench_compare_u64);
+                qsort(cycles, ITERATIONS, sizeof(cycles[0]), bench_compare_u64);
+
+                if (cycles_fd >= 0) {
+                    printf("mem/%s/%s/%u: %.3f ns/byte %.3f cycles/byte\n",
+                           mem_functions[function].name,
+                           mem_alignments[alignment].name,
+                           mem_sizes[size],
+                           (double)ns[ITERATIONS / 2] / bytes,
+                           (double)cycles[ITERATIONS / 2] / bytes);
+                } else {
+                    printf("mem/%s/%s/%u: %.3f ns/byte\n",
+                           mem_functions[function].name,
+                           mem_alignments[alignment].name,
+                           mem_sizes[size],
+                           (double)ns[ITERATIONS / 2] / bytes);
+                }
+
+                fprintf(results, "%s,%s,%u,%d,%llu,%llu,%lld,%.3f,%.3f\n",
+                        mem_functions[function].name,
+                        mem_alignments[alignment].name,
+                        mem_sizes[size],
+                        ITERATIONS,
+                        (unsigned long long)bytes,
+                        (unsigned long long)ns[ITERATIONS / 2],
+                        (cycles_fd >= 0) ?
+                            (long long)cycles[ITERATIONS / 2] : -1LL,
+                        (double)ns[ITERATIONS / 2] / bytes,
+                        (cycles_fd >= 0) ?
+                            (double)cycles[ITERATIONS / 2] / bytes : -1.0);
+            }
+        }
+    }
+
+    fclose(results);
+    if (cycles_fd >= 0) {
+        close(cycles_fd);
+    }
+}
@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include "appcfg.h"
+#include "greybus.h"
+#include "gbboot.h"
+#include "hostsim.h"
+#include "bootbench.h"
+
+/* the AP side of the gbboot protocol, answering from memory */
+static const uint8_t *served_image;
+static uint32_t served_size;
+static uint8_t ready_to_boot_status;
+
+static struct {
+    gb_operation_header header;
+    uint8_t payload[GB_LARGE_PAYLOAD_SIZE];
+} __attribute__ ((packed)) message;
+
+/**
+ * @brief Send a Greybus message to the bridge
+ */
+static void peer_send(uint16_t id, uint8_t type, const void *payload,
+                      uint16_t payload_size) {
+    message.header.size = sizeof(gb_operation_header) + payload_size;
+    message.header.id = id;
+    message.header.type = type;
+    message.header.status = GB_OP_SUCCESS;
+    message.header.padding = 0;
+    if (payload_size != 0) {
+        memcpy(message.payload, payload, payload_size);
+    }
+    hostsim_peer_send(GBBOOT_CPORT, &message, message.header.size);
+}
+
+static void peer_get_firmware(gb_operation_header *header) {
+    struct gbboot_get_firmware_request *req =
+        (struct gbboot_get_firmware_request *)(header + 1);
+
+    if (req->offset > served_size || req->size > served_size - req->offset ||
+        req->size > sizeof(message.payload)) {
+        printf("bootbench: bad GET_FIRMWARE %u@%u\n", req->size, req->offset);
+        peer_send(header->id, header->type | GB_TYPE_RESPONSE, NULL, 0);
+        return;
+    }
+    peer_send(header->id, header->type | GB_TYPE_RESPONSE,
+              served_image + req->offset, req->size);
+}
+
+/**
+ * @brief Handle a message from the bridge, see hostsim_set_peer
+ */
+static void peer_rx(uint16_t cportid, const void *data, size_t len) {
+    gb_operation_header *header = (gb_operation_header *)data;
+    struct gbboot_firmware_size_response size_response = {served_size};
+
+    if (cportid != GBBOOT_CPORT || len < sizeof(*header) ||
+        (header->type & GB_TYPE_RESPONSE)) {
+        /* nothing to do with the responses to our requests */
+        return;
+    }
+
+    switch (header->type) {
+    case GB_BOOT_OP_FIRMWARE_SIZE:
+        peer_send(header->id, header->type | GB_TYPE_RESPONSE,
+                  &size_response, sizeof(size_response));
+        break;
+    case GB_BOOT_OP_GET_FIRMWARE:
+        peer_get_firmware(header);
+        break;
+    case GB_BOOT_OP_READY_TO_BOOT:
+        ready_to_boot_status =
+            ((struct gbboot_ready_to_boot_request *)(header + 1))->status;
+        peer_send(header->id, header->type | GB_TYPE_RESPONSE, NULL, 0);
+        break;
+    default:
+        printf("bootbench: unexpected request 0x%02x\n", header->type);
+        break;
+    }
+}
+
+void bench_peer_start(const uint8_t *image, uint32_t size,
+                      uint32_t chunk_size) {
+    /* only a server announcing a recent enough version gets large chunks */
+    struct gbboot_protocol_version_request version = {
+        GB_BOOT_VERSION_LARGE_MAJOR, GB_BOOT_VERSION_LARGE_MINOR
+    };
+
+    if (chunk_size != GB_LARGE_PAYLOAD_SIZE) {
+        version.minor--;
+    }
+
+    served_image = image;
+    served_size = size;
+    ready_to_boot_status = GB_BOOT_BOOT_STATUS_INVALID;
+    hostsim_set_peer(peer_rx);
+
+    peer_send(1, GB_BOOT_OP_PROTOCOL_VERSION, &version, sizeof(version));
+    peer_send(0, GB_BOOT_OP_AP_READY, NULL, 0);
+}
+
+uint8_t bench_peer_stop(void) {
+    served_image = NULL;
+    served_size = 0;
+    return ready_to_boot_status;
+}
@@ -0,0 +1,273 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "crypto.h"
+#include "tftf.h"
+#include "data_loading.h"
+#include "bootbench.h"
+
+/* phases can nest: a transfer that hashes what it loads, and so on */
+#define PHASE_DEPTH_MAX 8
+
+static bench_sample *sample;
+static bench_phase phases[PHASE_DEPTH_MAX];
+static uint32_t depth;
+static uint64_t last_ns;
+static uint64_t last_instructions;
+
+/* counter of the instructions retired in user mode, -1 if there is none */
+static int instructions_fd = -1;
+
+uint64_t bench_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int bench_counter_open(uint64_t config) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    /* not there in most VMs, or not allowed (perf_event_paranoid) */
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+uint64_t bench_counter_read(int fd) {
+    uint64_t count;
+
+    if (fd < 0 || read(fd, &count, sizeof(count)) != sizeof(count)) {
+        return 0;
+    }
+    return count;
+}
+
+static uint64_t bench_instructions(void) {
+    return bench_counter_read(instructions_fd);
+}
+
+bool bench_phase_init(void) {
+    instructions_fd = bench_counter_open(PERF_COUNT_HW_INSTRUCTIONS);
+    return instructions_fd >= 0;
+}
+
+/**
+ * @brief Account what was done since the last call to the current phase
+ */
+static void bench_phase_charge(void) {
+    uint64_t ns = bench_ns();
+    uint64_t instructions = bench_instructions();
+
+    sample->ns[phases[depth]] += ns - last_ns;
+    sample->instructions[phases[depth]] += instructions - last_instructions;
+    last_ns = ns;
+    last_instructions = instructions;
+}
+
+void bench_phase_start(bench_sample *s) {
+    memset(s, 0, sizeof(*s));
+    sample = s;
+    depth = 0;
+    phases[0] = BENCH_PHASE_PARSE;
+    last_instructions = bench_instructions();
+    last_ns = bench_ns();
+}
+
+void bench_phase_stop(void) {
+    if (sample != NULL) {
+        bench_phase_charge();
+        sample = NULL;
+    }
+}
+
+void bench_phase_enter(bench_phase phase) {
+    if (sample == NULL) {
+        return;
+    }
+    bench_phase_charge();
+    if (depth + 1 < PHASE_DEPTH_MAX) {
+        depth++;
+    }
+    phases[depth] = phase;
+}
+
+void bench_phase_leave(void) {
+    if (sample == NULL) {
+        return;
+    }
+    bench_phase_charge();
+    if (depth > 0) {
+        depth--;
+    }
+}
+
+/*
+ * The crypto entry points, as called by tftf.c and the data_load_ops (the
+ * linker sends the calls here, see Sources.mk)
+ */
+void __wrap_hash_update(unsigned char *data, uint32_t datalen) {
+    bench_phase_enter(BENCH_PHASE_HASH);
+    __real_hash_update(data, datalen);
+    bench_phase_leave();
+}
+
+void __wrap_hash_final(unsigned char *digest) {
+    bench_phase_enter(BENCH_PHASE_HASH);
+    __real_hash_final(digest);
+    bench_phase_leave();
+}
+
+int __real_verify_signature(unsigned char *digest,
+                            tftf_signature *signature);
+int __real_verify_signature_start(tftf_signature *signature);
+void __real_verify_signature_step(void);
+int __real_verify_signature_finish(unsigned char *digest,
+                                   tftf_signature *signature);
+
+int __wrap_verify_signature(unsigned char *digest,
+                            tftf_signature *signature) {
+    int rc;
+
+    bench_phase_enter(BENCH_PHASE_VERIFY);
+    rc = __real_verify_signature(digest, signature);
+    bench_phase_leave();
+    return rc;
+}
+
+int __wrap_verify_signature_start(tftf_signature *signature) {
+    int rc;
+
+    bench_phase_enter(BENCH_PHASE_VERIFY);
+    rc = __real_verify_signature_start(signature);
+    bench_phase_leave();
+    return rc;
+}
+
+void __wrap_verify_signature_step(void) {
+    bench_phase_enter(BENCH_PHASE_VERIFY);
+    __real_verify_signature_step();
+    bench_phase_leave();
+}
+
+int __wrap_verify_signature_finish(unsigned char *digest,
+                                   tftf_signature *signature) {
+    int rc;
+
+    bench_phase_enter(BENCH_PHASE_VERIFY);
+    rc = __real_verify_signature_finish(digest, signature);
+    bench_phase_leave();
+    return rc;
+}
+
+/*
+ * data_load_ops accounting their calls as transfers. The hashing a load does
+ * is accounted as such by the wrappers above.
+ */
+static data_load_ops *timed;
+
+static int timed_init(void) {
+    int rc;
+
+    bench_phase_enter(BENCH_PHASE_TRANSFER);
+    rc = timed->init();
+    bench_phase_leave();
+    return rc;
+}
+
+static int timed_read(void *dest, uint32_t addr, uint32_t length) {
+    int rc;
+
+    bench_phase_enter(BENCH_PHASE_TRANSFER);
+    rc = timed->read(dest, addr, length);
+    bench_phase_leave();
+    return rc;
+}
+
+static int timed_load(void *dest, uint32_t length, bool hash) {
+    int rc;
+
+    bench_phase_enter(BENCH_PHASE_TRANSFER);
+    rc = timed->load(dest, length, hash);
+    bench_phase_leave();
+    return rc;
+}
+
+static int timed_fetch(void *dest, uint32_t pos, uint32_t length) {
+    int rc;
+
+    bench_phase_enter(BENCH_PHASE_TRANSFER);
+    rc = timed->fetch(dest, pos, length);
+    bench_phase_leave();
+    return rc;
+}
+
+static int timed_seek(uint32_t length) {
+    int rc;
+
+    bench_phase_enter(BENCH_PHASE_TRANSFER);
+    rc = timed->seek(length);
+    bench_phase_leave();
+    return rc;
+}
+
+static int timed_finish(bool valid, bool is_secure_image) {
+    int rc;
+
+    bench_phase_enter(BENCH_PHASE_TRANSFER);
+    rc = timed->finish(valid, is_secure_image);
+    bench_phase_leave();
+    return rc;
+}
+
+data_load_ops *bench_timed_ops(data_load_ops *ops) {
+    static data_load_ops timed_ops;
+
+    timed = ops;
+    timed_ops.init = timed_init;
+    timed_ops.load = timed_load;
+    timed_ops.finish = timed_finish;
+    /* the optional ones stay absent, the loaders check */
+    timed_ops.read = (ops->read != NULL) ? timed_read : NULL;
+    timed_ops.fetch = (ops->fetch != NULL) ? timed_fetch : NULL;
+    timed_ops.seek = (ops->seek != NULL) ? timed_seek : NULL;
+    return &timed_ops;
+}
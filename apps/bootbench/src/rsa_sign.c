@@ -0,0 +1,287 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "crypto.h"
+#include "bootbench.h"
+
+#define WORDS   RSA2048_PUBLIC_KEY_WORDS
+
+/*
+ * The key the benchmark images are signed with. It was made for the
+ * benchmark only and must never be trusted by anything (e=65537).
+ */
+static const unsigned char test_key_modulus[RSA2048_PUBLIC_KEY_SIZE] = {
+    0xcf,0x34,0x34,0x83,0xb1,0xf6,0x0d,0x71,0x9c,0x54,0x02,0x98,
+    0x40,0x18,0x4d,0x29,0x5b,0xf3,0xa5,0x4f,0x41,0x5c,0xaa,0xdc,
+    0x2a,0xfd,0x7c,0x39,0x2d,0x59,0xa1,0xef,0x8f,0x39,0xe3,0x4e,
+    0xc0,0xe3,0x36,0x34,0xa4,0xce,0xaa,0x4a,0x15,0xb2,0x6f,0xb7,
+    0x08,0xa6,0x7d,0x65,0x36,0x7f,0xe5,0x71,0xb4,0xb5,0xa1,0xfa,
+    0xa0,0x0d,0x65,0xfd,0x6a,0x11,0x39,0x8a,0xb9,0xca,0x8a,0xd5,
+    0x0f,0x1e,0xfc,0x81,0x70,0xf7,0xf2,0xff,0x5d,0x37,0xe8,0x37,
+    0x65,0x6c,0x11,0x36,0x66,0x2a,0x21,0x1f,0x1e,0x4b,0x92,0xdd,
+    0xd0,0xb3,0x0c,0xc9,0x95,0x3e,0x85,0x7e,0x02,0x4f,0x8e,0x85,
+    0xf9,0xe3,0xa3,0x39,0x97,0x90,0x5a,0x34,0x0b,0xce,0x52,0x4e,
+    0x83,0xc7,0x64,0xa8,0xb2,0x62,0x07,0x1b,0x9f,0x63,0x0a,0x05,
+    0x58,0x4c,0x84,0x2b,0x98,0x7b,0xf5,0x7b,0x21,0xbd,0x21,0x32,
+    0x28,0xe3,0x1e,0xd4,0x18,0xb0,0x65,0x2a,0x27,0x24,0x35,0x9a,
+    0xc6,0x02,0x04,0x76,0x5b,0xad,0x11,0xfe,0x55,0x89,0xc8,0xef,
+    0xfe,0x87,0x2f,0xe3,0xb3,0x56,0xb5,0xa5,0x1e,0xd5,0xc7,0xf3,
+    0xb8,0xca,0xff,0xcc,0x5c,0x2d,0x41,0x34,0xcf,0x87,0xc2,0x72,
+    0x6a,0x36,0xb3,0x1c,0x76,0xbc,0x5e,0x2d,0x90,0x90,0x95,0x45,
+    0x8c,0x84,0xdd,0x1a,0x53,0xa8,0x5b,0xaa,0xaf,0xc9,0x86,0x0d,
+    0xba,0x7d,0x48,0xa8,0x7b,0x3d,0x79,0x13,0xa2,0x9f,0xb6,0x9c,
+    0xae,0x58,0xa9,0xf5,0x4c,0xd2,0xcd,0x2a,0x7c,0x4d,0x6e,0xd3,
+    0x03,0x0a,0x80,0xaf,0x7c,0xaf,0x75,0x5e,0x01,0x60,0xe5,0xa1,
+    0x4f,0x8a,0xfe,0x19,
+};
+
+static const unsigned char test_key_exponent[RSA2048_PUBLIC_KEY_SIZE] = {
+    0x70,0x12,0xd4,0xb4,0xc6,0xf5,0x47,0xa0,0x43,0xe6,0x4c,0xe0,
+    0xfd,0x0a,0x27,0xf2,0x4f,0x02,0x22,0x50,0x14,0x12,0x83,0x78,
+    0x42,0xe8,0x88,0xe0,0x84,0x5f,0x0e,0xef,0xfc,0x90,0x5b,0x1a,
+    0xa5,0xca,0x3f,0xef,0x89,0x95,0x1f,0x16,0xa3,0x55,0xb8,0x87,
+    0x4f,0xee,0x7d,0xb4,0xd9,0x1d,0xa4,0x85,0x34,0x31,0x6a,0x43,
+    0x9d,0x7e,0xa1,0xc3,0xc8,0x33,0x38,0xe4,0x88,0x49,0xbd,0x7e,
+    0x30,0x87,0x9a,0x1c,0x89,0x76,0x13,0xc1,0x7c,0x32,0x59,0x30,
+    0x5d,0x73,0x6e,0x7b,0xf6,0x16,0xa3,0x83,0xa9,0x67,0x47,0x31,
+    0x23,0x49,0x35,0x89,0x73,0x68,0x35,0xdc,0x4a,0x73,0xad,0xab,
+    0x59,0xd6,0x7e,0xdb,0x0f,0xd7,0xcc,0x72,0x8a,0x50,0x36,0xc4,
+    0xb1,0x12,0x90,0xa7,0x8e,0x94,0xe7,0x32,0x58,0x82,0x5e,0x5a,
+    0x39,0x9c,0xfa,0x6d,0xd6,0xcf,0x13,0x9d,0xde,0x17,0x72,0xc0,
+    0x0b,0xa7,0x0b,0x58,0xf2,0xcc,0xc4,0x90,0xa0,0xbc,0x03,0x02,
+    0x74,0x2f,0xd1,0x7c,0x46,0xec,0x83,0xd4,0x63,0x9a,0xff,0xa7,
+    0xbe,0x14,0x9b,0x52,0x33,0x64,0x4a,0xb2,0xf8,0xb6,0x6f,0x4c,
+    0xe8,0xb7,0xec,0x6e,0x97,0x3b,0x93,0x5f,0x07,0x54,0x23,0xf7,
+    0xb5,0x75,0x74,0xbd,0xe6,0xf5,0xb7,0x35,0x31,0x22,0x0a,0x08,
+    0x6f,0x16,0xf3,0x0a,0x6e,0xf9,0x60,0x95,0xda,0xd4,0x4a,0x7c,
+    0x4d,0x3e,0x8a,0x52,0xb7,0xb6,0x19,0x96,0x88,0xfe,0xf5,0x5f,
+    0x58,0xeb,0xae,0x53,0xaa,0xe0,0x79,0x11,0x48,0xc2,0x6e,0x36,
+    0x2b,0xb9,0x21,0x30,0x0f,0x92,0x63,0x4f,0x59,0x64,0x64,0x52,
+    0x36,0xd8,0x60,0x61,
+};
+
+/* DER DigestInfo header of a SHA256 digest */
+static const unsigned char sha256_digest_info[] = {
+    0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03,
+    0x04, 0x02, 0x01, 0x05, 0x00, 0x04, 0x20
+};
+
+/* the test key as little-endian arrays of 32-bit words, see crypto.h */
+static struct {
+    bool ready;
+    uint32_t n[WORDS];
+    uint32_t n0;            /* -1/n mod 2^32 */
+    uint32_t r2[WORDS];     /* 2^4096 mod n */
+} key;
+
+static void words_from_bytes(uint32_t *x, const unsigned char *bytes) {
+    const unsigned char *p;
+    uint32_t i;
+
+    for (i = 0; i < WORDS; i++) {
+        p = &bytes[RSA2048_PUBLIC_KEY_SIZE - sizeof(uint32_t) * (i + 1)];
+        x[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+               ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+    }
+}
+
+static void bytes_from_words(unsigned char *bytes, const uint32_t *x) {
+    unsigned char *p;
+    uint32_t i;
+
+    for (i = 0; i < WORDS; i++) {
+        p = &bytes[RSA2048_PUBLIC_KEY_SIZE - sizeof(uint32_t) * (i + 1)];
+        p[0] = x[i] >> 24;
+        p[1] = x[i] >> 16;
+        p[2] = x[i] >> 8;
+        p[3] = x[i];
+    }
+}
+
+static int compare(const uint32_t *x, const uint32_t *y) {
+    int i;
+
+    for (i = WORDS - 1; i >= 0; i--) {
+        if (x[i] != y[i]) {
+            return (x[i] > y[i]) ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+/* x -= y, modulo 2^2048 */
+static void subtract(uint32_t *x, const uint32_t *y) {
+    uint64_t borrow = 0;
+    uint64_t d;
+    uint32_t i;
+
+    for (i = 0; i < WORDS; i++) {
+        d = (uint64_t)x[i] - y[i] - borrow;
+        x[i] = (uint32_t)d;
+        borrow = (d >> 32) & 1;
+    }
+}
+
+/* r = a * b / 2^2048 mod n, the same CIOS method as the verification */
+static void mont_mul(uint32_t *r, const uint32_t *a, const uint32_t *b) {
+    uint32_t t[WORDS + 2];
+    uint64_t acc;
+    uint32_t carry, q;
+    uint32_t i, j;
+
+    memset(t, 0, sizeof(t));
+    for (i = 0; i < WORDS; i++) {
+        carry = 0;
+        for (j = 0; j < WORDS; j++) {
+            acc = (uint64_t)a[j] * b[i] + t[j] + carry;
+            t[j] = (uint32_t)acc;
+            carry = acc >> 32;
+        }
+        acc = (uint64_t)t[WORDS] + carry;
+        t[WORDS] = (uint32_t)acc;
+        t[WORDS + 1] = acc >> 32;
+
+        q = t[0] * key.n0;
+        acc = (uint64_t)q * key.n[0] + t[0];
+        carry = acc >> 32;
+        for (j = 1; j < WORDS; j++) {
+            acc = (uint64_t)q * key.n[j] + t[j] + carry;
+            t[j - 1] = (uint32_t)acc;
+            carry = acc >> 32;
+        }
+        acc = (uint64_t)t[WORDS] + carry;
+        t[WORDS - 1] = (uint32_t)acc;
+        t[WORDS] = t[WORDS + 1] + (uint32_t)(acc >> 32);
+    }
+
+    if (t[WORDS] || compare(t, key.n) >= 0) {
+        subtract(t, key.n);
+    }
+    memcpy(r, t, WORDS * sizeof(uint32_t));
+}
+
+static void key_setup(void) {
+    uint32_t x, carry, top;
+    uint32_t i, j;
+
+    if (key.ready) {
+        return;
+    }
+
+    words_from_bytes(key.n, test_key_modulus);
+
+    /* Newton iteration, each step doubles the number of good bits */
+    x = key.n[0];
+    for (i = 0; i < 5; i++) {
+        x *= 2 - key.n[0] * x;
+    }
+    key.n0 = -x;
+
+    /* 2^2048 mod n is -n for a full size modulus, double it 2048 times */
+    memset(key.r2, 0, sizeof(key.r2));
+    subtract(key.r2, key.n);
+    for (i = 0; i < RSA2048_PUBLIC_KEY_SIZE * 8; i++) {
+        top = key.r2[WORDS - 1] >> 31;
+        carry = 0;
+        for (j = 0; j < WORDS; j++) {
+            x = key.r2[j];
+            key.r2[j] = (x << 1) | carry;
+            carry = x >> 31;
+        }
+        if (top || compare(key.r2, key.n) >= 0) {
+            subtract(key.r2, key.n);
+        }
+    }
+
+    key.ready = true;
+}
+
+void bench_rsa_public_key(crypto_public_key *public_key,
+                          crypto_public_key_mont *mont) {
+    key_setup();
+
+    memset(public_key, 0, sizeof(*public_key));
+    public_key->type = ALGORITHM_TYPE_RSA2048_SHA256;
+    memcpy(public_key->key_name, BENCH_KEY_NAME, sizeof(BENCH_KEY_NAME));
+    memcpy(public_key->key, test_key_modulus, sizeof(public_key->key));
+
+    mont->n0 = key.n0;
+    memcpy(mont->modulus, key.n, sizeof(mont->modulus));
+    memcpy(mont->r2, key.r2, sizeof(mont->r2));
+}
+
+void bench_rsa_sign(const unsigned char digest[SHA256_HASH_DIGEST_SIZE],
+                    unsigned char signature[RSA2048_PUBLIC_KEY_SIZE]) {
+    unsigned char padded[RSA2048_PUBLIC_KEY_SIZE];
+    uint32_t m[WORDS], c[WORDS], one[WORDS];
+    uint32_t d[WORDS];
+    int bit;
+    bool started = false;
+
+    key_setup();
+
+    /* 00 01 FF .. FF 00 DigestInfo digest */
+    padded[0] = 0x00;
+    padded[1] = 0x01;
+    memset(&padded[2], 0xFF, sizeof(padded) - 3 -
+                             sizeof(sha256_digest_info) -
+                             SHA256_HASH_DIGEST_SIZE);
+    padded[sizeof(padded) - 1 - sizeof(sha256_digest_info) -
+           SHA256_HASH_DIGEST_SIZE] = 0x00;
+    memcpy(&padded[sizeof(padded) - sizeof(sha256_digest_info) -
+                   SHA256_HASH_DIGEST_SIZE],
+           sha256_digest_info, sizeof(sha256_digest_info));
+    memcpy(&padded[sizeof(padded) - SHA256_HASH_DIGEST_SIZE], digest,
+           SHA256_HASH_DIGEST_SIZE);
+
+    /* c = m^d mod n, left to right, in Montgomery form */
+    words_from_bytes(m, padded);
+    words_from_bytes(d, test_key_exponent);
+    mont_mul(m, m, key.r2);
+    for (bit = RSA2048_PUBLIC_KEY_SIZE * 8 - 1; bit >= 0; bit--) {
+        if (started) {
+            mont_mul(c, c, c);
+        }
+        if (d[bit / 32] & (1U << (bit % 32))) {
+            if (started) {
+                mont_mul(c, c, m);
+            } else {
+                memcpy(c, m, sizeof(c));
+                started = true;
+            }
+        }
+    }
+
+    memset(one, 0, sizeof(one));
+    one[0] = 1;
+    mont_mul(c, c, one);
+    bytes_from_words(signature, c);
+}
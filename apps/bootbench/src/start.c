@@ -0,0 +1,546 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "appcfg.h"
+#include "chipapi.h"
+#include "bootrom.h"
+#include "error.h"
+#include "debug.h"
+#include "unipro.h"
+#include "data_loading.h"
+#include "tftf.h"
+#include "ffff.h"
+#include "crypto.h"
+#include "greybus.h"
+#include "gbboot.h"
+#include "utils.h"
+#include "hostsim.h"
+#include "bootbench.h"
+
+/**
+ * Boot-latency benchmark
+ *
+ * Each image of the matrix below is loaded ITERATIONS times over each of the
+ * transports, by the same code the second stage boots the third with:
+ * locate_ffff_element_on_storage and load_tftf_image over spi_ops, or
+ * load_tftf_image over greybus_ops with the AP played by peer.c. The time of
+ * each load is split into the bench_phase's and checked against the budgets
+ * of appcfg.h. One image is loaded again over Greybus from an AP slow to
+ * answer, waiting in WFI and by polling (see bench_wait_modes). Then FFFF
+ * tables of more and more elements are located (read and validated) on their
+ * own, and last the memory functions of utils.c are timed over a range of
+ * sizes and alignments (see membench.c).
+ *
+ * The results are printed the way the MIRACL benchmarks do, and written to
+ * BOOTBENCH_RESULTS_FILE as CSV for scripts to compare runs.
+ */
+
+extern data_load_ops spi_ops;
+extern data_load_ops greybus_ops;
+
+const int nIter = ITERATIONS;
+
+#define KB 1024
+
+/* up to what fits in workram with the largest header and a signature */
+static const uint32_t payload_sizes[] = {16 * KB, 64 * KB, 160 * KB};
+static const uint32_t section_counts[] = {1, 8, 64};
+
+/* FFFF tables alone, up to about all a 32KB header holds */
+static const uint32_t ffff_element_counts[] = {4, 16, 64, 256, 1600};
+
+typedef enum {
+    BENCH_SPI,
+    BENCH_GREYBUS,
+} bench_transport;
+
+static const struct {
+    const char *name;
+    bench_transport transport;
+    uint32_t chunk_size;        /* largest GET_FIRMWARE, Greybus only */
+} transports[] = {
+    {"spi", BENCH_SPI, 0},
+    {"gb2k", BENCH_GREYBUS, GB_MAX_PAYLOAD_SIZE},
+    {"gb8k", BENCH_GREYBUS, GB_LARGE_PAYLOAD_SIZE},
+};
+
+/*
+ * The ways of waiting for the Greybus responses of an AP that takes
+ * BOOTBENCH_PEER_LATENCY_NS to answer, compared on this image
+ */
+static const struct {
+    const char *name;
+    bool wfi;
+} wait_modes[] = {
+    {"poll", false},
+    {"wfi", true},
+};
+static const bench_image_params wait_image = {64 * KB, 1, false};
+
+static const char * const phase_names[NUMBER_OF_BENCH_PHASES] = {
+    [BENCH_PHASE_PARSE] = "parse",
+    [BENCH_PHASE_HASH] = "hash",
+    [BENCH_PHASE_VERIFY] = "verify",
+    [BENCH_PHASE_TRANSFER] = "transfer",
+};
+
+static bench_sample samples[ITERATIONS];
+static bool counting_instructions;
+static FILE *results;
+
+/**
+ * @brief Load an image once
+ *
+ * @param transport index in transports[]
+ * @param params what the image is made of
+ * @param image the image
+ * @param sample where to store the time spent in each phase
+ *
+ * @returns 0 if the image loaded and was (un)trusted as expected, <0 if not
+ */
+static int bench_load(uint32_t transport,
+                      const bench_image_params *params,
+                      bench_image *image,
+                      bench_sample *sample) {
+    data_load_ops *ops;
+    uint32_t is_secure_image = 0;
+    uint8_t expected_status;
+    int rc;
+
+    /* what the second stage does before each load, and not timed */
+    chip_clear_image_loading_ram();
+    init_last_error();
+
+    if (transports[transport].transport == BENCH_SPI) {
+        if (hostsim_flash_set(image->flash, image->flash_size)) {
+            return -1;
+        }
+        ops = bench_timed_ops(&spi_ops);
+    } else {
+        bench_peer_start(image->tftf, image->tftf_size,
+                         transports[transport].chunk_size);
+        ops = bench_timed_ops(&greybus_ops);
+    }
+
+    bench_phase_start(sample);
+    rc = ops->init();
+    if (rc == 0 && ops->read != NULL) {
+        rc = locate_ffff_element_on_storage(ops, FFFF_ELEMENT_STAGE_3_FW,
+                                            NULL);
+    }
+    if (rc == 0) {
+        rc = load_tftf_image(ops, &is_secure_image);
+    }
+    if (ops->finish(rc == 0, is_secure_image)) {
+        rc = -1;
+    }
+    bench_phase_stop();
+
+    if (transports[transport].transport == BENCH_GREYBUS) {
+        expected_status = params->is_signed ? GB_BOOT_BOOT_STATUS_SECURE :
+                                              GB_BOOT_BOOT_STATUS_INSECURE;
+        if (bench_peer_stop() != expected_status) {
+            rc = -1;
+        }
+    }
+    if (rc == 0 && is_secure_image != params->is_signed) {
+        rc = -1;
+    }
+    if (rc != 0) {
+        printf("Load failed, error 0x%08x\n", get_last_error());
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Locate the stage 3 element of an FFFF table once
+ *
+ * @param image the flash image with the table
+ * @param sample where to store the time spent in each phase
+ *
+ * @returns 0 if the table was found valid, <0 if not
+ */
+static int bench_locate(bench_image *image, bench_sample *sample) {
+    data_load_ops *ops;
+    int rc;
+
+    init_last_error();
+    if (hostsim_flash_set(image->flash, image->flash_size)) {
+        return -1;
+    }
+    ops = bench_timed_ops(&spi_ops);
+
+    bench_phase_start(sample);
+    rc = ops->init();
+    if (rc == 0) {
+        rc = locate_ffff_element_on_storage(ops, FFFF_ELEMENT_STAGE_3_FW,
+                                            NULL);
+    }
+    bench_phase_stop();
+
+    if (rc != 0) {
+        printf("Locate failed, error 0x%08x\n", get_last_error());
+        return -1;
+    }
+    return 0;
+}
+
+int bench_compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Get the budgets of the phases of loading an image, in ns
+ *
+ * @param params what the image is made of
+ * @param image the image
+ * @param budget where to store the budget of each phase
+ *
+ * @returns Nothing
+ */
+static void bench_image_budget(const bench_image_params *params,
+                               const bench_image *image,
+                               uint64_t budget[NUMBER_OF_BENCH_PHASES]) {
+    budget[BENCH_PHASE_PARSE] = BOOTBENCH_BUDGET_PARSE_NS +
+            (uint64_t)BOOTBENCH_BUDGET_PARSE_NS_PER_SECTION *
+            params->number_of_sections;
+    budget[BENCH_PHASE_HASH] = BOOTBENCH_BUDGET_HASH_NS +
+            (uint64_t)BOOTBENCH_BUDGET_HASH_NS_PER_BYTE *
+            image->hashed_size;
+    budget[BENCH_PHASE_VERIFY] = BOOTBENCH_BUDGET_VERIFY_NS +
+            (uint64_t)BOOTBENCH_BUDGET_VERIFY_NS_PER_SIGNATURE *
+            (params->is_signed ? 1 : 0);
+    budget[BENCH_PHASE_TRANSFER] = BOOTBENCH_BUDGET_TRANSFER_NS +
+            (uint64_t)BOOTBENCH_BUDGET_TRANSFER_NS_PER_BYTE *
+            image->tftf_size;
+}
+
+/**
+ * @brief Get the budgets of the phases of locating an FFFF table, in ns
+ *
+ * @param number_of_elements the number of elements in the table
+ * @param image the flash image with the table
+ * @param budget where to store the budget of each phase
+ *
+ * @returns Nothing
+ */
+static void bench_ffff_budget(uint32_t number_of_elements,
+                              const bench_image *image,
+                              uint64_t budget[NUMBER_OF_BENCH_PHASES]) {
+    budget[BENCH_PHASE_PARSE] = BOOTBENCH_BUDGET_FFFF_NS +
+            (uint64_t)BOOTBENCH_BUDGET_FFFF_NS_PER_ELEMENT *
+            number_of_elements;
+    /* no TFTF in there */
+    budget[BENCH_PHASE_HASH] = 0;
+    budget[BENCH_PHASE_VERIFY] = 0;
+    /* both copies of the header are read */
+    budget[BENCH_PHASE_TRANSFER] = BOOTBENCH_BUDGET_TRANSFER_NS +
+            (uint64_t)BOOTBENCH_BUDGET_TRANSFER_NS_PER_BYTE *
+            image->flash_size;
+}
+
+/**
+ * @brief Report the time of each phase over the iterations of a case
+ *
+ * @param name name of the case, for humans
+ * @param csv_case the leading fields of the case's CSV lines
+ * @param budget the budget of each phase, in ns. The phases without one
+ *        are not part of the case, and not reported.
+ *
+ * @returns the number of phases over budget
+ */
+static int bench_report(const char *name,
+                        const char *csv_case,
+                        const uint64_t budget[NUMBER_OF_BENCH_PHASES]) {
+    uint64_t ns[ITERATIONS];
+    uint64_t instructions[ITERATIONS];
+    uint64_t total;
+    unsigned int totalTime;
+    int64_t median_instructions;
+    int over = 0;
+    int phase;
+    int i;
+
+    for (phase = 0; phase < NUMBER_OF_BENCH_PHASES; phase++) {
+        if (budget[phase] == 0) {
+            continue;
+        }
+
+        total = 0;
+        for (i = 0; i < nIter; i++) {
+            ns[i] = samples[i].ns[phase];
+            instructions[i] = samples[i].instructions[phase];
+            total += ns[i];
+        }
+        qsort(ns, nIter, sizeof(ns[0]), bench_compare_u64);
+        qsort(instructions, nIter, sizeof(instructions[0]), bench_compare_u64);
+        median_instructions = counting_instructions ?
+                              (int64_t)instructions[nIter / 2] : -1;
+
+        if (ns[nIter / 2] > budget[phase]) {
+            over++;
+        }
+
+        totalTime = total / 1000;
+        printf("%s %s: Iterations %d Total %d usecs Iteration %d usecs %s\n",
+               name, phase_names[phase], nIter, totalTime, totalTime / nIter,
+               (ns[nIter / 2] > budget[phase]) ? "OVER BUDGET" : "");
+
+        fprintf(results, "%s,%s,%d,%llu,%llu,%llu,%lld,%llu,%d\n",
+                csv_case,
+                phase_names[phase],
+                nIter,
+                (unsigned long long)ns[nIter / 2],
+                (unsigned long long)ns[0],
+                (unsigned long long)ns[nIter - 1],
+                (long long)median_instructions,
+                (unsigned long long)budget[phase],
+                ns[nIter / 2] > budget[phase]);
+    }
+
+    return over;
+}
+
+/**
+ * @brief Compare waiting for Greybus responses in WFI and by polling
+ *
+ * The image is loaded over each Greybus transport from an AP that takes
+ * BOOTBENCH_PEER_LATENCY_NS to answer. Polling sees a response as soon as it
+ * is in, at the cost of spinning in greybus_loop. WFI sleeps until then, and
+ * wakes up later than that by however long the wake up takes: the difference
+ * in transfer time between the two is that latency.
+ *
+ * @param none
+ *
+ * @returns the number of phases over budget
+ */
+static int bench_wait_modes(void) {
+    bench_image image;
+    uint64_t budget[NUMBER_OF_BENCH_PHASES];
+    uint64_t transfer_ns[ARRAY_SIZE(wait_modes)];
+    uint64_t ns[ITERATIONS];
+    uint32_t requests;
+    char name[64];
+    char csv_case[64];
+    uint32_t transport, mode;
+    int over = 0;
+    int i;
+
+    printf("Generating image\n");
+    if (bench_image_build(&wait_image, &image)) {
+        printf("bootbench: can't generate the image\n");
+        hostsim_exit(2);
+    }
+    hostsim_set_peer_latency(BOOTBENCH_PEER_LATENCY_NS);
+
+    for (transport = 0; transport < ARRAY_SIZE(transports); transport++) {
+        if (transports[transport].transport != BENCH_GREYBUS) {
+            continue;
+        }
+
+        /* GET_FIRMWARE's, plus FIRMWARE_SIZE and READY_TO_BOOT */
+        requests = (image.tftf_size + transports[transport].chunk_size - 1) /
+                   transports[transport].chunk_size + 2;
+        bench_image_budget(&wait_image, &image, budget);
+        budget[BENCH_PHASE_TRANSFER] += (uint64_t)requests *
+                (BOOTBENCH_PEER_LATENCY_NS + BOOTBENCH_BUDGET_WAKE_NS);
+
+        for (mode = 0; mode < ARRAY_SIZE(wait_modes); mode++) {
+            snprintf(name, sizeof(name), "%s+%s/%uK/%u/%s",
+                     transports[transport].name,
+                     wait_modes[mode].name,
+                     wait_image.payload_size / KB,
+                     wait_image.number_of_sections,
+                     wait_image.is_signed ? "signed" : "unsigned");
+            snprintf(csv_case, sizeof(csv_case), "%s+%s,%u,%u,%u,%u",
+                     transports[transport].name,
+                     wait_modes[mode].name,
+                     transports[transport].chunk_size,
+                     wait_image.payload_size,
+                     wait_image.number_of_sections,
+                     wait_image.is_signed);
+
+            hostsim_set_wfi(wait_modes[mode].wfi);
+            for (i = 0; i < nIter; i++) {
+                if (bench_load(transport, &wait_image, &image,
+                               &samples[i])) {
+                    printf("%s: load failed\n", name);
+                    hostsim_exit(2);
+                }
+                ns[i] = samples[i].ns[BENCH_PHASE_TRANSFER];
+            }
+            over += bench_report(name, csv_case, budget);
+
+            qsort(ns, nIter, sizeof(ns[0]), bench_compare_u64);
+            transfer_ns[mode] = ns[nIter / 2];
+        }
+
+        printf("%s: transfer of %u requests %llu usecs polling, "
+               "%llu usecs in WFI\n",
+               transports[transport].name, requests,
+               (unsigned long long)transfer_ns[0] / 1000,
+               (unsigned long long)transfer_ns[1] / 1000);
+    }
+
+    hostsim_set_wfi(true);
+    hostsim_set_peer_latency(0);
+    bench_image_free(&image);
+    return over;
+}
+
+/**
+ * @brief Benchmark entry point, in place of the second stage's
+ *
+ * @param none
+ *
+ * @returns Nothing. Exits 0 if all went well, 1 if a phase was over its
+ *          budget, 2 if an image failed to load.
+ */
+void bootrom_main(void) {
+    bench_image_params params;
+    bench_image image;
+    uint64_t budget[NUMBER_OF_BENCH_PHASES];
+    char name[64];
+    char csv_case[64];
+    uint32_t size, sections, is_signed, transport, elements;
+    int over = 0;
+    int i;
+
+    chip_init();
+    dbginit();
+    init_last_error();
+    crypto_init();
+    chip_unipro_init();
+    if (greybus_init()) {
+        printf("bootbench: greybus_init failed\n");
+        hostsim_exit(2);
+    }
+
+    bench_cfgdata_init();
+    counting_instructions = bench_phase_init();
+
+    results = fopen(BOOTBENCH_RESULTS_FILE, "w");
+    if (results == NULL) {
+        perror(BOOTBENCH_RESULTS_FILE);
+        hostsim_exit(2);
+    }
+    /* for the FFFF tables, transport is "ffff" and sections are elements */
+    fprintf(results, "transport,chunk_size,payload_size,sections,signed,"
+            "phase,iterations,median_ns,min_ns,max_ns,median_instructions,"
+            "budget_ns,over_budget\n");
+
+    printf("bootbench: %d iterations per image, instructions %s\n", nIter,
+           counting_instructions ? "counted" : "not counted (no PMU access)");
+
+    for (size = 0; size < ARRAY_SIZE(payload_sizes); size++) {
+        for (sections = 0; sections < ARRAY_SIZE(section_counts); sections++) {
+            for (is_signed = 0; is_signed <= 1; is_signed++) {
+                params.payload_size = payload_sizes[size];
+                params.number_of_sections = section_counts[sections];
+                params.is_signed = is_signed;
+
+                printf("Generating image\n");
+                if (bench_image_build(&params, &image)) {
+                    printf("bootbench: can't generate the image\n");
+                    hostsim_exit(2);
+                }
+                bench_image_budget(&params, &image, budget);
+
+                for (transport = 0; transport < ARRAY_SIZE(transports);
+                     transport++) {
+                    snprintf(name, sizeof(name), "%s/%uK/%u/%s",
+                             transports[transport].name,
+                             params.payload_size / KB,
+                             params.number_of_sections,
+                             params.is_signed ? "signed" : "unsigned");
+                    snprintf(csv_case, sizeof(csv_case), "%s,%u,%u,%u,%u",
+                             transports[transport].name,
+                             transports[transport].chunk_size,
+                             params.payload_size,
+                             params.number_of_sections,
+                             params.is_signed);
+
+                    for (i = 0; i < nIter; i++) {
+                        if (bench_load(transport, &params, &image,
+                                       &samples[i])) {
+                            printf("%s: load failed\n", name);
+                            hostsim_exit(2);
+                        }
+                    }
+                    over += bench_report(name, csv_case, budget);
+                }
+
+                bench_image_free(&image);
+            }
+        }
+    }
+
+    over += bench_wait_modes();
+
+    for (elements = 0; elements < ARRAY_SIZE(ffff_element_counts);
+         elements++) {
+        printf("Generating FFFF table\n");
+        if (bench_ffff_table_build(ffff_element_counts[elements], &image)) {
+            printf("bootbench: can't generate the FFFF table\n");
+            hostsim_exit(2);
+        }
+        bench_ffff_budget(ffff_element_counts[elements], &image, budget);
+
+        snprintf(name, sizeof(name), "ffff/%u",
+                 ffff_element_counts[elements]);
+        snprintf(csv_case, sizeof(csv_case), "ffff,0,0,%u,0",
+                 ffff_element_counts[elements]);
+
+        for (i = 0; i < nIter; i++) {
+            if (bench_locate(&image, &samples[i])) {
+                printf("%s: locate failed\n", name);
+                hostsim_exit(2);
+            }
+        }
+        over += bench_report(name, csv_case, budget);
+
+        bench_image_free(&image);
+    }
+
+    bench_mem();
+
+    fclose(results);
+    printf("bootbench: results in %s, %d phase(s) over budget\n",
+           BOOTBENCH_RESULTS_FILE, over);
+    hostsim_exit(over ? 1 : 0);
+}
@@ -42,6 +42,7 @@
 #include "ffff.h"
 #include "crypto.h"
 #include "bootrom.h"
+#include "boot_profile.h"
 
 extern data_load_ops spi_ops;
 extern data_load_ops greybus_ops;
@@ -64,6 +65,7 @@ void bootrom_main(void) {
     uint32_t    is_secure_image;
 
     chip_init();
+    boot_profile_init();
 
     dbginit();
 
@@ -79,6 +81,7 @@ void bootrom_main(void) {
 #endif
 
     chip_unipro_init();
+    boot_profile_mark(BOOT_PHASE_UNIPRO_INIT, 0);
 
     /* Advertise our boot status */
     chip_advertise_boot_status(boot_status);
@@ -95,6 +98,7 @@ void bootrom_main(void) {
     if (efuse_init() != 0) {
         halt_and_catch_fire(boot_status);
     }
+    boot_profile_mark(BOOT_PHASE_EFUSE_INIT, 0);
 
     /* determine if we're booting from flash or UniPro */
     register_val = tsb_get_bootselector();
@@ -105,6 +109,7 @@ void bootrom_main(void) {
         dbgprint("Boot from SPIROM\n");
 
         spi_ops.init();
+        boot_profile_mark(BOOT_PHASE_LOAD_INIT, 0);
 
         /**
          * Call locate_ffff_element_on_storage to locate next stage FW.
@@ -113,6 +118,7 @@ void bootrom_main(void) {
         if (locate_ffff_element_on_storage(&spi_ops,
                                            FFFF_ELEMENT_STAGE_2_FW,
                                            NULL) == 0) {
+            boot_profile_mark(BOOT_PHASE_LOCATE_FFFF, 0);
             boot_status = INIT_STATUS_SPI_BOOT_STARTED;
             chip_advertise_boot_status(boot_status);
             if (!load_tftf_image(&spi_ops, &is_secure_image)) {
@@ -171,6 +177,7 @@ void bootrom_main(void) {
         if (greybus_ops.init() != 0) {
             halt_and_catch_fire(boot_status);
         }
+        boot_profile_mark(BOOT_PHASE_LOAD_INIT, 0);
         if (!load_tftf_image(&greybus_ops, &is_secure_image)) {
             if (greybus_ops.finish(true, is_secure_image) != 0) {
                 halt_and_catch_fire(boot_status);
@@ -71,6 +71,7 @@ uint32_t tsb_get_jtag_disable(void);
 void display_epuid_ims_cms_info(void);
 void report_bootrom_hash(void);
 void report_communication_area(void);
+void report_boot_profile(boot_profile_data *profile);
 
 char * shared_function_names [NUMBER_OF_SHARED_FUNCTIONS] = {
     "SHA256_INIT",
@@ -80,6 +81,27 @@ char * shared_function_names [NUMBER_OF_SHARED_FUNCTIONS] = {
     "ENTER_STANDBY",
 };
 
+char * shared_function_ext_names [NUMBER_OF_SHARED_FUNCTIONS_EXT] = {
+    "SHA256_PROCESS_BLOCK",
+    "RSA2048_VERIFY_MONT",
+    "RSA2048_POW_START",
+    "RSA2048_POW_STEP",
+    "RSA2048_POW_CHECK",
+};
+
+char * boot_phase_names [NUMBER_OF_BOOT_PHASES] = {
+    "ENTRY",
+    "UNIPRO_INIT",
+    "EFUSE_INIT",
+    "LOAD_INIT",
+    "LOCATE_FFFF",
+    "TFTF_HEADER",
+    "TFTF_SECTION",
+    "HASH_FINAL",
+    "VERIFY_SIGNATURE",
+    "JUMP",
+};
+
 
 
 /**
@@ -407,6 +429,48 @@ void report_bootrom_hash(void) {
 
 
 
+/**
+ * @brief Print the boot phase profile left by the earlier boot stages
+ *
+ * Each line shows the stage, the phase which ended, the cycle count at that
+ * point and the cycles spent since the previous event.
+ *
+ * @param profile The boot profile in the communication area
+ *
+ * @returns Nothing.
+ */
+void report_boot_profile(boot_profile_data *profile) {
+    boot_profile_event *event;
+    int i;
+
+    dbgprint("boot_profile:\n");
+    if (profile->num_events == 0 ||
+        profile->num_events > BOOT_PROFILE_MAX_EVENTS) {
+        dbgprint("  none (earlier stages built without _BOOT_PROFILE=1?)\n");
+        return;
+    }
+
+    for (i = 0; i < profile->num_events; i++) {
+        event = &profile->events[i];
+        dbgprintx32("  s", event->stage, " ");
+        if (event->phase < NUMBER_OF_BOOT_PHASES) {
+            dbgprint(boot_phase_names[event->phase]);
+        } else {
+            dbgprint("?");
+        }
+        if (event->phase == BOOT_PHASE_TFTF_SECTION) {
+            dbgprintx32(" ", event->arg, NULL);
+        }
+        dbgprintx32(": cycles 0x", event->cycles, NULL);
+        dbgprintx32(" (+0x",
+                    event->cycles - (i ? profile->events[i - 1].cycles : 0),
+                    ")\n");
+    }
+    if (profile->lost_events) {
+        dbgprintx32("  (0x", profile->lost_events, " events lost)\n");
+    }
+}
+
 /**
  * @brief Report all relevant data from Communication Area
  *
@@ -436,6 +500,14 @@ void report_communication_area(void) {
     }
     dbgprint("\n");
 
+    /* shared_functions_ext */
+    dbgprint("shared_functions_ext:\n");
+    for (i = 0; i < NUMBER_OF_SHARED_FUNCTIONS_EXT; i++) {
+        dbgprintx("  ", shared_function_ext_names[i], NULL);
+        dbgprintxptr("  0x", get_shared_function_ext(i), "\n");
+    }
+    dbgprint("\n");
+
     /* endpoint_unique_id */
     dbgprintxbuf("endpoint_unique_id: ",
             comm_area->endpoint_unique_id,
@@ -465,5 +537,7 @@ void report_communication_area(void) {
            sizeof(comm_area->firmware_package_name));
     text_buf[sizeof(comm_area->firmware_package_name)] = '\0';
     dbgprintx("firmware_package_name: '", text_buf, "'\n");
+
+    report_boot_profile(&comm_area->boot_profile);
 }
 
@@ -26,7 +26,9 @@
  * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include "chipapi.h"
 #include "unipro.h"
 #include "error.h"
@@ -40,6 +42,7 @@
 #include "chipdef.h"
 #include "special_test.h"
 #include "bootrom.h"
+#include "appcfg.h"
 
 extern data_load_ops spi_ops;
 
@@ -79,6 +82,31 @@ void bootrom_main(void) {
     }
 }
 
+/*
+ * The server can serve one gbboot client per entry of conn[] after the
+ * control connection, each on its own CPort. The state of a download lives
+ * in gbboot_clients[], indexed by the local CPort of the connection, and
+ * gbboot_process() services whichever client CPorts have a request pending
+ * in a single receive loop.
+ */
+struct gbboot_client {
+    bool connected;
+    bool download_finished;
+    int stage_to_load;
+    uint32_t fw_location;   /* address of the element on flash */
+    uint32_t fw_size;
+    uint32_t next_offset;   /* expected offset of the next GET_FIRMWARE */
+    uint32_t prefetch_size; /* size to read ahead at next_offset, 0: none */
+};
+
+static struct gbboot_client gbboot_clients[CPORT_MAX];
+static uint32_t gbboot_client_cports;   /* bit n set for client cport n */
+
+/*
+ * conn[0] is the control connection, and each further entry connects one
+ * gbboot client. The link only reaches the one peer, so there is a single
+ * client here: serving more of them at once takes a switch in between.
+ */
 struct unipro_connection conn[] = {
     {
         .port_id0 = SWITCH_PORT_ID,
@@ -182,30 +210,64 @@ static int gb_control(void) {
                          NULL,
                          0);
     unipro_receive_blocking(CONTROL_CPORT, server_control_cport_handler);
-    struct unipro_connection *c = &conn[1];
-    uint16_t to_connect = c->cport_id1;
-    create_connection(c);
-    greybus_send_request(CONTROL_CPORT,
-                         1,
-                         GB_CTRL_OP_CONNECTED,
-                         (unsigned char *)&to_connect,
-                         sizeof(to_connect));
 
-    unipro_receive_blocking(CONTROL_CPORT, server_control_cport_handler);
+    /* one gbboot client per connection after the control one */
+    int i;
+    gbboot_client_cports = 0;
+    for (i = 1; i < ARRAY_SIZE(conn); i++) {
+        struct unipro_connection *c = &conn[i];
+        uint16_t to_connect = c->cport_id1;
+        create_connection(c);
+        greybus_send_request(CONTROL_CPORT,
+                             1,
+                             GB_CTRL_OP_CONNECTED,
+                             (unsigned char *)&to_connect,
+                             sizeof(to_connect));
+
+        unipro_receive_blocking(CONTROL_CPORT, server_control_cport_handler);
+
+        memset(&gbboot_clients[c->cport_id0], 0,
+               sizeof(gbboot_clients[c->cport_id0]));
+        gbboot_clients[c->cport_id0].connected = true;
+        gbboot_client_cports |= (1 << c->cport_id0);
+    }
     return 0;
 }
 
-static bool image_download_finished = false;
-static int stage_to_load;
-static int gbboot_get_firmware_size(uint32_t cportid,
-                                  gb_operation_header *op_header) {
+/*
+ * Flash read cache, shared by all the clients: once a GET_FIRMWARE response
+ * is on its way, the chunk that follows it is read ahead into fw_cache (see
+ * gbboot_prefetch_firmware). It is keyed by flash address rather than by
+ * client, so clients loading the same element share it.
+ */
+static uint8_t fw_cache[GB_LARGE_PAYLOAD_SIZE] __attribute__ ((aligned(4)));
+static uint32_t fw_cache_addr;
+static uint32_t fw_cache_size;          /* 0: nothing cached */
+static struct gbboot_client *prefetch_client;
+
+/*
+ * GET_FIRMWARE payload read from flash on demand. chip_unipro_send copies
+ * it, or the chunk in fw_cache, out behind the response header.
+ */
+static uint8_t fw_payload[GB_LARGE_PAYLOAD_SIZE] __attribute__ ((aligned(4)));
+
+static int gbboot_get_firmware_size(struct gbboot_client *client,
+                                    uint32_t cportid,
+                                    gb_operation_header *op_header) {
     int rc;
     uint8_t *payload = (uint8_t *)op_header + sizeof(*op_header);
     uint32_t size;
     spi_ops.init();
 
-    stage_to_load = *payload - 1;
-    rc = locate_ffff_element_on_storage(&spi_ops, stage_to_load, &size);
+    client->stage_to_load = *payload - 1;
+    rc = locate_ffff_element_on_storage(&spi_ops, client->stage_to_load,
+                                        &size);
+    if (rc == 0) {
+        rc = get_ffff_element_location(&client->fw_location);
+    }
+    client->fw_size = (rc == 0) ? size : 0;
+    client->next_offset = 0;
+    client->prefetch_size = 0;
 
     dbgprintx32("image size: ", size, "\n");
 
@@ -224,17 +286,94 @@ static int gbboot_get_firmware_size(uint32_t cportid,
                                sizeof(size));
 }
 
-static int gbboot_get_firmware(uint32_t cportid,
-                             gb_operation_header *op_header) {
+/**
+ * @brief Get a chunk of a client's firmware element
+ *
+ * Served from fw_cache when it holds the whole chunk, read from flash into
+ * fw_payload otherwise.
+ *
+ * @param client The client the chunk is for
+ * @param data Set to where the chunk is
+ * @param offset Offset of the chunk in the element
+ * @param size Size of the chunk
+ *
+ * @returns 0 on success, <0 on error
+ */
+static int gbboot_read_firmware(struct gbboot_client *client, uint8_t **data,
+                                uint32_t offset, uint32_t size) {
+    uint32_t addr = client->fw_location + offset;
+
+    if (fw_cache_size != 0 && addr >= fw_cache_addr &&
+        addr + size <= fw_cache_addr + fw_cache_size) {
+        *data = &fw_cache[addr - fw_cache_addr];
+        return 0;
+    }
+    *data = fw_payload;
+    return spi_ops.read(fw_payload, addr, size);
+}
+
+/**
+ * @brief Read ahead the chunk following the last GET_FIRMWARE response
+ *
+ * Called with the RX restarted, so the next request can come in while the
+ * flash is being read. Does nothing if there is nothing to read ahead, or
+ * if it is in the cache already.
+ */
+static void gbboot_prefetch_firmware(void) {
+    struct gbboot_client *client = prefetch_client;
+    uint32_t addr;
+    uint32_t size;
+
+    prefetch_client = NULL;
+    if (client == NULL || client->prefetch_size == 0 ||
+        client->next_offset >= client->fw_size) {
+        return;
+    }
+
+    size = client->prefetch_size;
+    client->prefetch_size = 0;
+    if (size > client->fw_size - client->next_offset) {
+        size = client->fw_size - client->next_offset;
+    }
+
+    addr = client->fw_location + client->next_offset;
+    if (fw_cache_size != 0 && addr >= fw_cache_addr &&
+        addr + size <= fw_cache_addr + fw_cache_size) {
+        return;
+    }
+
+    fw_cache_size = 0;
+    if (spi_ops.read(fw_cache, addr, size) == 0) {
+        fw_cache_addr = addr;
+        fw_cache_size = size;
+    }
+}
+
+static int gbboot_get_firmware(struct gbboot_client *client,
+                               uint32_t cportid,
+                               gb_operation_header *op_header) {
     int rc;
+    uint8_t *data;
     uint8_t *payload = (uint8_t *)op_header + sizeof(*op_header);
     struct __attribute__ ((packed)) get_fw_req {
         uint32_t offset;
         uint32_t size;
     } *req = (struct get_fw_req *)payload;
-    uint8_t data[req->size];
 
-    rc = spi_ops.load(data, req->size, false);
+    if (req->size > GB_LARGE_PAYLOAD_SIZE ||
+        req->offset > client->fw_size ||
+        req->size > client->fw_size - req->offset) {
+        return greybus_op_response(cportid,
+                                   op_header,
+                                   GB_OP_INVALID,
+                                   NULL,
+                                   0);
+    }
+
+    rc = gbboot_read_firmware(client, &data, req->offset, req->size);
+    client->next_offset = req->offset + req->size;
+    client->prefetch_size = req->size;
+    prefetch_client = client;
 
     return greybus_op_response(cportid,
                                op_header,
@@ -243,12 +382,13 @@ static int gbboot_get_firmware(uint32_t cportid,
                                req->size);
 }
 
-static int gbboot_ready_to_boot(uint32_t cportid,
-                              gb_operation_header *op_header) {
+static int gbboot_ready_to_boot(struct gbboot_client *client,
+                                uint32_t cportid,
+                                gb_operation_header *op_header) {
     uint8_t *payload = (uint8_t *)op_header + sizeof(*op_header);
     dbgprintx32("ready-to-boot, status: ", *payload, "\n");
 
-    image_download_finished = true;
+    client->download_finished = true;
 #if _SPECIAL_TEST == SPECIAL_GEAR_CHANGE_TEST
     switch_gear_change(GEAR_HS_G3,
                        TERMINATION_ON,
@@ -280,14 +420,20 @@ static int gbboot_cport_handler(uint32_t cportid,
         return -1;
     }
 
+    if (cportid >= CPORT_MAX || !gbboot_clients[cportid].connected) {
+        dbgprint("gbboot_cport_handler: no client on cport\n");
+        return -1;
+    }
+    struct gbboot_client *client = &gbboot_clients[cportid];
+
     gb_operation_header *op_header = (gb_operation_header *)data;
 
     switch (op_header->type) {
     case GB_BOOT_OP_FIRMWARE_SIZE:
-        rc = gbboot_get_firmware_size(cportid, op_header);
+        rc = gbboot_get_firmware_size(client, cportid, op_header);
         break;
     case GB_BOOT_OP_GET_FIRMWARE:
-        rc = gbboot_get_firmware(cportid, op_header);
+        rc = gbboot_get_firmware(client, cportid, op_header);
 #if _SPECIAL_TEST == SPECIAL_GEAR_CHANGE_TEST
     switch_gear_change(GEAR_HS_G2,
                        TERMINATION_ON,
@@ -297,7 +443,7 @@ static int gbboot_cport_handler(uint32_t cportid,
 #endif
         break;
     case GB_BOOT_OP_READY_TO_BOOT:
-        rc = gbboot_ready_to_boot(cportid, op_header);
+        rc = gbboot_ready_to_boot(client, cportid, op_header);
         break;
     default:
         break;
@@ -306,23 +452,58 @@ static int gbboot_cport_handler(uint32_t cportid,
     return rc;
 }
 
+/**
+ * @brief Check whether every connected client is done downloading
+ *
+ * @returns true if no client has a download in progress
+ */
+static bool gbboot_all_downloads_finished(void) {
+    int i;
+
+    for (i = 0; i < CPORT_MAX; i++) {
+        if (gbboot_clients[i].connected &&
+            !gbboot_clients[i].download_finished) {
+            return false;
+        }
+    }
+    return true;
+}
+
 static int gbboot_process(void) {
-    unsigned char ver[] = {0, 1};
-    greybus_send_request(gbboot_CPORT,
-                         1,
-                         GB_BOOT_OP_PROTOCOL_VERSION,
-                         ver,
-                         2);
-    unipro_receive_blocking(gbboot_CPORT, gbboot_cport_handler);
-    greybus_send_request(gbboot_CPORT,
-                         1,
-                         GB_BOOT_OP_AP_READY,
-                         NULL,
-                         0);
-    unipro_receive_blocking(gbboot_CPORT, gbboot_cport_handler);
-    image_download_finished = false;
-    while (!image_download_finished) {
-        unipro_receive_blocking(gbboot_CPORT, gbboot_cport_handler);
+    /* announcing 0.2 lets the client ask for up to GB_LARGE_PAYLOAD_SIZE */
+    unsigned char ver[] = {GB_BOOT_VERSION_MAJOR, GB_BOOT_VERSION_MINOR};
+    uint32_t cportid;
+    int i;
+
+    fw_cache_size = 0;
+    prefetch_client = NULL;
+    for (i = 1; i < ARRAY_SIZE(conn); i++) {
+        cportid = conn[i].cport_id0;
+        greybus_send_request(cportid,
+                             1,
+                             GB_BOOT_OP_PROTOCOL_VERSION,
+                             ver,
+                             2);
+        unipro_receive_blocking(cportid, gbboot_cport_handler);
+        greybus_send_request(cportid,
+                             1,
+                             GB_BOOT_OP_AP_READY,
+                             NULL,
+                             0);
+        unipro_receive_blocking(cportid, gbboot_cport_handler);
+    }
+
+    /*
+     * Every pass services each client cport with a request pending once,
+     * so a client streaming its firmware can't starve the others.
+     */
+    while (!gbboot_all_downloads_finished()) {
+        if (chip_unipro_receive_ready(gbboot_client_cports,
+                                      gbboot_cport_handler) < 0) {
+            return -1;
+        }
+        /* the responses are on their way and RX is restarted: read ahead */
+        gbboot_prefetch_firmware();
     }
     return 0;
 }
@@ -360,7 +541,7 @@ static void server_loop(void) {
     gb_control();
     gbboot_process();
 #if _SPECIAL_TEST == SPECIAL_GBBOOT_SERVER_STANDBY
-    if (stage_to_load == FFFF_ELEMENT_STAGE_2_FW)
+    if (gbboot_clients[gbboot_CPORT].stage_to_load == FFFF_ELEMENT_STAGE_2_FW)
         chip_enter_hibern8_server();
 #endif
 }
@@ -42,6 +42,7 @@
 #include "ffff.h"
 #include "crypto.h"
 #include "bootrom.h"
+#include "boot_profile.h"
 #include "2ndstage_cfgdata.h"
 #include "greybus.h"
 #include "spi-gb.h"
@@ -125,6 +126,7 @@ void bootrom_main(void) {
     secondstage_cfgdata *cfgdata;
 
     chip_init();
+    boot_profile_init();
 
     dbginit();
 
@@ -147,10 +149,12 @@ void bootrom_main(void) {
             if (efuse_init() != 0) {
                 halt_and_catch_fire(boot_status);
             }
+            boot_profile_mark(BOOT_PHASE_EFUSE_INIT, 0);
         }
     }
 
     chip_unipro_init();
+    boot_profile_mark(BOOT_PHASE_UNIPRO_INIT, 0);
 
     boot_control(&boot_from_spi);
 
@@ -166,6 +170,7 @@ void bootrom_main(void) {
         dbgprint("Boot from SPIROM\n");
 
         spi_ops.init();
+        boot_profile_mark(BOOT_PHASE_LOAD_INIT, 0);
 
         /**
          * Call locate_ffff_element_on_storage to locate next stage FW.
@@ -174,6 +179,7 @@ void bootrom_main(void) {
         if (locate_ffff_element_on_storage(&spi_ops,
                                            FFFF_ELEMENT_STAGE_3_FW,
                                            NULL) == 0) {
+            boot_profile_mark(BOOT_PHASE_LOCATE_FFFF, 0);
             boot_status = INIT_STATUS_SPI_BOOT_STARTED;
             chip_advertise_boot_status(boot_status);
             if (!load_tftf_image(&spi_ops, &is_secure_image)) {
@@ -251,6 +257,7 @@ void bootrom_main(void) {
         if (greybus_ops.init() != 0) {
             halt_and_catch_fire(boot_status);
         }
+        boot_profile_mark(BOOT_PHASE_LOAD_INIT, 0);
         if (!load_tftf_image(&greybus_ops, &is_secure_image)) {
             if (greybus_ops.finish(true, is_secure_image) != 0) {
                 halt_and_catch_fire(boot_status);
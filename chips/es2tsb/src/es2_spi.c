@@ -80,6 +80,15 @@ static int data_load_mmapped_load(void *dest, uint32_t length, bool hash) {
     return 0;
 }
 
+static int data_load_mmapped_seek(uint32_t length) {
+    if(initialized != 1 ||
+       current_addr + length >= (uint8_t*)(MMAP_LOAD_BASE + MMAP_LOAD_SIZE))
+        return -1;
+
+    current_addr += length;
+    return 0;
+}
+
 static int data_load_mmapped_finish(bool valid, bool is_secure_image) {
     /* disable SPI master clock. */
     tsb_clk_disable(TSB_CLK_SPIS);
@@ -94,5 +103,6 @@ data_load_ops spi_ops = {
     .init = data_load_mmapped_init,
     .read = data_load_mmapped_read,
     .load = data_load_mmapped_load,
-    .finish = data_load_mmapped_finish
+    .finish = data_load_mmapped_finish,
+    .seek = data_load_mmapped_seek
 };
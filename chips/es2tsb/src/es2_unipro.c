@@ -302,6 +302,9 @@ void chip_unipro_init(void) {
     tsb_unipro_write(UNIPRO_INT_EN, 1);
 
     tsb_reset_all_cports();
+#ifdef _UNIPRO_WFI
+    tsb_unipro_enable_events();
+#endif
     dbgprint("Unipro enabled!\n");
 }
 
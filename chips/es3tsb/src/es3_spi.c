@@ -32,14 +32,18 @@
 #include "debug.h"
 #include "data_loading.h"
 #include "crypto.h"
+#include "tftf_crypto.h"
 
 static uint32_t current_addr;
+/* start of the image being loaded, which "fetch" offsets are relative to */
+static uint32_t image_addr;
 
 #define SPIM_CTRLR0 (SPI_BASE)
 #define SPIM_CTRLR1 (SPI_BASE + 0x04)
 #define SPIM_SSIENR (SPI_BASE + 0x08)
 #define SPIM_SER    (SPI_BASE + 0x10)
 #define SPIM_BAUDR  (SPI_BASE + 0x14)
+#define SPIM_RXFTLR (SPI_BASE + 0x1C)
 #define SPIM_SR     (SPI_BASE + 0x28)
 #define SPIM_DR0    (SPI_BASE + 0x60)
 
@@ -57,12 +61,56 @@ static uint32_t current_addr;
 /* SPI_CS_0_N */
 #define SPIM_SLAVE_SELECT (1 << 0)
 
+/*
+ * Plain READ is the fastest read command available here. SCKDV must be an
+ * even value of at least 2, so 24MHz (half of the 48MHz SSI clock) is already
+ * the highest SPI clock the master can generate, and the master only has a
+ * single data line. FAST_READ (0x0B) would only add a dummy byte per command
+ * at this clock, and the dual/quad output reads need a multi-line master.
+ */
 #define SPI_FLASH_READ_CMD 0x03
 
+/*
+ * Hashed loads are read in bursts that fit in the RX FIFO, so that the data
+ * already received can be hashed while the next burst is clocked in without
+ * any risk of overflowing the FIFO. A burst of 16 frames hashes 64 bytes (one
+ * SHA-256 block) at a time. Bursts shorter than 4 frames cost more in read
+ * commands than they gain, so streaming is not used on such small FIFOs.
+ */
+#define SPIM_RX_FIFO_DEPTH_MAX  256
+#define SPIM_STREAM_BURST_MIN   4
+#define SPIM_STREAM_BURST_MAX   16
+
 int spi_clk_usage_count = 0;
 
+/* frames per burst for hashed loads, or 0 to not stream */
+static uint32_t stream_burst;
+
+/**
+ * @brief Find the depth of the SPI master RX FIFO
+ *
+ * RXFTLR only holds values below the FIFO depth, so write increasing values
+ * until one does not read back. Must be called with the SSI disabled.
+ *
+ * @returns The RX FIFO depth in frames
+ */
+static uint32_t spi_rx_fifo_depth(void) {
+    uint32_t depth;
+
+    for (depth = 1; depth < SPIM_RX_FIFO_DEPTH_MAX; depth++) {
+        putreg32(depth, SPIM_RXFTLR);
+        if (getreg32(SPIM_RXFTLR) != depth) {
+            break;
+        }
+    }
+    putreg32(0, SPIM_RXFTLR);
+
+    return depth;
+}
+
 static int data_load_spi_init(void) {
     current_addr = 0;
+    image_addr = 0;
 
     /* enable SPI master clock.
        Pinshare should be default to SPI (CS0) after reset */
@@ -75,16 +123,71 @@ static int data_load_spi_init(void) {
     putreg32(SPIM_SCKDV,  SPIM_BAUDR);
     putreg32(SPIM_SLAVE_SELECT,  SPIM_SER);
 
+    stream_burst = spi_rx_fifo_depth();
+    if (stream_burst > SPIM_STREAM_BURST_MAX) {
+        stream_burst = SPIM_STREAM_BURST_MAX;
+    } else if (stream_burst < SPIM_STREAM_BURST_MIN) {
+        stream_burst = 0;
+    }
+
     return 0;
 }
 
+/**
+ * @brief Start reading 32-bit frames from the SPI flash at current_addr
+ *
+ * @param count The number of frames to read (1 to 64k)
+ */
+static void spi_start_read(uint32_t count) {
+    putreg32(count - 1, SPIM_CTRLR1);
+    putreg32(SPIM_SSI_ENABLE,  SPIM_SSIENR);
+    putreg32((SPI_FLASH_READ_CMD << 24) | current_addr, SPIM_DR0);
+}
+
+/**
+ * @brief Receive the frames of a read started by spi_start_read
+ *
+ * @param pdest Where to store the data
+ *
+ * @returns The number of frames received
+ */
+static uint32_t spi_receive(unsigned char *pdest) {
+    uint32_t c;
+    uint32_t sr, dr;
+    unsigned char *pdr = (unsigned char *)&dr;
+
+    c = 0;
+    while(1) {
+        sr = getreg32(SPIM_SR);
+        /* The spec says that "BUSY" doesn't happen right away with not much
+           explaination. However, it should be safe to assume it would happen
+           no later than the first frame is received */
+        if (c && !(sr & (SPIM_SR_BUSY | SPIM_SR_RFNE))) {
+            break;
+        }
+        if (sr & SPIM_SR_RFNE) {
+            dr = getreg32(SPIM_DR0);
+            *pdest++ = pdr[3];
+            *pdest++ = pdr[2];
+            *pdest++ = pdr[1];
+            *pdest++ = pdr[0];
+            c++;
+        }
+    }
+    putreg32(SPIM_SSI_DISABLE,  SPIM_SSIENR);
+
+    return c;
+}
+
 /* TA-15 CM3 perform read data transfer from SPI memory to data transfer... */
 static int data_load_spi_load(void *dest, uint32_t length, bool hash) {
     uint32_t c;
     uint32_t sr, dr;
     unsigned char *pdest = (unsigned char *)dest;
+    unsigned char *phashed = (unsigned char *)dest;
     unsigned char *pdr = (unsigned char *)&dr;
     uint32_t count = length >> 2;
+    uint32_t burst;
 
     if (length == 0) {
         return 0;
@@ -105,48 +208,48 @@ static int data_load_spi_load(void *dest, uint32_t length, bool hash) {
         return -1;
     }
 
-    putreg32(count - 1, SPIM_CTRLR1);
-    putreg32(SPIM_SSI_ENABLE,  SPIM_SSIENR);
-    putreg32((SPI_FLASH_READ_CMD << 24) | current_addr, SPIM_DR0);
-    c = 0;
-    while(1) {
-        sr = getreg32(SPIM_SR);
-        /* The spec says that "BUSY" doesn't happen right away with not much
-           explaination. However, it should be safe to assume it would happen
-           no later than the first frame is received */
-        if (c && !(sr & (SPIM_SR_BUSY | SPIM_SR_RFNE))) {
-            break;
+    while (count) {
+        burst = count;
+        if (hash && stream_burst && burst > stream_burst) {
+            burst = stream_burst;
         }
-        if (sr & SPIM_SR_RFNE) {
-            dr = getreg32(SPIM_DR0);
-            *pdest++ = pdr[3];
-            *pdest++ = pdr[2];
-            *pdest++ = pdr[1];
-            *pdest++ = pdr[0];
-            c++;
+
+        spi_start_read(burst);
+
+        /* Hash what we have so far while this burst is being clocked in.
+           The burst fits in the RX FIFO, so nothing is lost if the hashing
+           takes longer than the transfer */
+        if (hash && phashed != pdest) {
+            hash_update(phashed, pdest - phashed);
+            phashed = pdest;
+        }
+        if (hash) {
+            /* and spend the rest of the wait on a signature check started
+               ahead of time */
+            verify_signature_step();
         }
-    }
-    putreg32(SPIM_SSI_DISABLE,  SPIM_SSIENR);
 
-    if (c != count) {
-        /* During experiment, RX FIFO overflow was observed in certain
-           conditions, so data loss happened. However, the boot ROM is running
-           under fixed core and SPI clocks and single threaded. So once the
-           code is finalized, the behavior of each party is predictable and
-           this error should never happen.
-           The check is just for cautious. */
-        return -1;
+        if (spi_receive(pdest) != burst) {
+            /* During experiment, RX FIFO overflow was observed in certain
+               conditions, so data loss happened. However, the boot ROM is
+               running under fixed core and SPI clocks and single threaded.
+               So once the code is finalized, the behavior of each party is
+               predictable and this error should never happen.
+               The check is just for cautious. */
+            return -1;
+        }
+
+        pdest += burst << 2;
+        current_addr += burst << 2;
+        current_addr &= 0x00FFFFFF;
+        count -= burst;
     }
 
     count = length & 3;
-    current_addr += (length & ~3);
-    current_addr &= 0x00FFFFFF;
 
     if (0 != count) {
         /* read trailing bytes */
-        putreg32(0, SPIM_CTRLR1);
-        putreg32(SPIM_SSI_ENABLE,  SPIM_SSIENR);
-        putreg32((SPI_FLASH_READ_CMD << 24) | current_addr, SPIM_DR0);
+        spi_start_read(1);
         while(1) {
             sr = getreg32(SPIM_SR);
             if (sr & SPIM_SR_RFNE) {
@@ -162,7 +265,7 @@ static int data_load_spi_load(void *dest, uint32_t length, bool hash) {
     }
 
     if (hash) {
-        hash_update((unsigned char *)dest, length);
+        hash_update(phashed, pdest - phashed);
     }
     return 0;
 }
@@ -170,12 +273,28 @@ static int data_load_spi_load(void *dest, uint32_t length, bool hash) {
 static int data_load_spi_read(void *dest, uint32_t addr, uint32_t length) {
     current_addr = addr;
     if (0 == length) {
+        image_addr = addr;
         return 0;
     }
 
     return data_load_spi_load(dest, length, false);
 }
 
+static int data_load_spi_fetch(void *dest, uint32_t offset, uint32_t length) {
+    uint32_t saved_addr = current_addr;
+    int rc;
+
+    current_addr = image_addr + offset;
+    rc = data_load_spi_load(dest, length, false);
+    current_addr = saved_addr;
+    return rc;
+}
+
+static int data_load_spi_seek(uint32_t length) {
+    current_addr = (current_addr + length) & 0x00FFFFFF;
+    return 0;
+}
+
 static int data_load_spi_finish(bool valid, bool is_secure_image) {
     spi_clk_usage_count--;
     if (spi_clk_usage_count == 0) {
@@ -189,5 +308,7 @@ data_load_ops spi_ops = {
     .init = data_load_spi_init,
     .read = data_load_spi_read,
     .load = data_load_spi_load,
-    .finish = data_load_spi_finish
+    .finish = data_load_spi_finish,
+    .fetch = data_load_spi_fetch,
+    .seek = data_load_spi_seek
 };
@@ -107,6 +107,9 @@ int chip_unipro_attr_write(uint16_t attr,
 
 void chip_unipro_init(void) {
     tsb_reset_all_cports();
+#ifdef _UNIPRO_WFI
+    tsb_unipro_enable_events();
+#endif
     dbgprint("Unipro enabled\n");
 }
 
@@ -0,0 +1,171 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * hostsim: the chip layer of a simulated ES3 bridge, for running the boot
+ * ROM apps as Linux programs.
+ *
+ * - SPI flash is a file, mapped read-only
+ * - workram is mapped at its real address, from a file if one is given so
+ *   that what a stage leaves in it (communication area included) can be
+ *   picked up by the next stage
+ * - the UniPro link is a UNIX socket between the bridge and a gbboot_server
+ *   build, carrying CPort messages and peer DME accesses, or a peer in the
+ *   same program (see hostsim_set_peer)
+ * - DME attributes are a table
+ */
+
+#ifndef __CHIPS_HOSTSIM_HOSTSIM_H
+#define __CHIPS_HOSTSIM_HOSTSIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* same as the TSB CPort buffers */
+#define HOSTSIM_CPORT_BUF_SIZE  (0x2000U)
+
+#define HOSTSIM_LINK_PATH       "hostsim-unipro.sock"
+
+/* UniPro ConfigResultCodes returned for DME accesses that fail */
+#define HOSTSIM_DME_INVALID_MIB_ATTRIBUTE       1
+#define HOSTSIM_DME_PEER_COMMUNICATION_FAILURE  8
+
+/* the SPI read command only has 24 address bits */
+#define HOSTSIM_FLASH_SIZE_MAX  (16 * 1024 * 1024)
+
+struct hostsim_options {
+    const char *flash_image;    /* SPI flash image file, NULL: no flash */
+    const char *workram_file;   /* file backing workram, NULL: anonymous */
+    const char *link_path;      /* UNIX socket standing in for the link */
+    bool boot_over_unipro;      /* bootselector SPIBOOT_N */
+};
+
+extern struct hostsim_options hostsim_options;
+
+/**
+ * @brief Stop the simulation
+ * @param status exit status of the program
+ */
+void hostsim_exit(int status) __attribute__ ((noreturn));
+
+/**
+ * @brief Access the local DME attribute table
+ * @param attr DME attribute address
+ * @param val value to write, or destination to read into
+ * @param selector attribute selector index
+ * @param write true to write, false to read
+ * @return 0 on success, >0 UniPro error if the table is full
+ */
+int hostsim_dme_access(uint16_t attr,
+                       uint32_t *val,
+                       uint16_t selector,
+                       bool write);
+
+/**
+ * @brief Set up the DME attributes the hardware would have after reset
+ */
+void hostsim_dme_init(void);
+
+/**
+ * @brief Map the SPI flash image
+ * @return 0 on success, <0 on error
+ */
+int hostsim_flash_init(void);
+
+/**
+ * @brief Read from the SPI flash image
+ *
+ * Like the flash, the address wraps around at the end of the image.
+ *
+ * @param dest where to read to
+ * @param addr flash address
+ * @param length number of bytes to read
+ */
+void hostsim_flash_read(void *dest, uint32_t addr, uint32_t length);
+
+/**
+ * @brief Use an image in memory as the SPI flash, instead of the -f file
+ * @param image the flash image, which must stay put while it is in use
+ * @param size size of the image
+ * @return 0 on success, <0 if the size is out of range
+ */
+int hostsim_flash_set(const void *image, uint32_t size);
+
+/**
+ * @brief Handler of the CPort messages sent to an in-process peer
+ * @param cportid CPort the message was sent on
+ * @param data the message
+ * @param len size of the message
+ */
+typedef void (*hostsim_peer_rx)(uint16_t cportid, const void *data,
+                                size_t len);
+
+/**
+ * @brief Put the other end of the link in this process
+ *
+ * Rather than going over the socket, CPort messages are handed to rx as they
+ * are sent, and rx answers with hostsim_peer_send. The peer has no DME. This
+ * is for programs such as benchmarks that drive both ends themselves.
+ *
+ * @param rx handler of the messages the bridge sends
+ */
+void hostsim_set_peer(hostsim_peer_rx rx);
+
+/**
+ * @brief Make the messages of the in-process peer take a while to get in
+ *
+ * Models an AP that takes time to answer: hostsim_peer_send queues the
+ * message right away, but the bridge only gets it ns later.
+ *
+ * @param ns the delay, 0 (the default) for none
+ */
+void hostsim_set_peer_latency(uint32_t ns);
+
+/**
+ * @brief Send a CPort message from the in-process peer to the bridge
+ * @param cportid CPort the message is for
+ * @param data the message
+ * @param len size of the message
+ */
+void hostsim_peer_send(uint16_t cportid, const void *data, size_t len);
+
+#ifdef _UNIPRO_WFI
+/**
+ * @brief Choose how chip_unipro_wait_event waits
+ *
+ * So that a program can compare both ways in one run: disabled, it returns
+ * at once as it does in builds without _UNIPRO_WFI, and the callers poll.
+ *
+ * @param enable true (the default) to sleep until there is something to
+ *        receive, false to return at once
+ */
+void hostsim_set_wfi(bool enable);
+#endif
+
+#endif /* __CHIPS_HOSTSIM_HOSTSIM_H */
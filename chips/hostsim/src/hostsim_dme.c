@@ -0,0 +1,160 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "chipapi.h"
+#include "unipro.h"
+#include "tsb_dme.h"
+#include "hostsim.h"
+
+/*
+ * Every attribute written so far, by the code, by the peer or by a -a
+ * option. Attributes never written read as 0.
+ */
+#define HOSTSIM_DME_ATTRS_MAX   256
+
+static struct hostsim_dme_attr {
+    uint16_t attr;
+    uint16_t selector;
+    uint32_t val;
+} dme_attrs[HOSTSIM_DME_ATTRS_MAX];
+
+static uint32_t dme_attr_count;
+
+/**
+ * @brief Find an attribute in the table
+ * @param attr DME attribute address
+ * @param selector attribute selector index
+ * @param create true to add the attribute if it is not in the table yet
+ * @return the table entry, NULL if not found (or the table is full)
+ */
+static struct hostsim_dme_attr *hostsim_dme_find(uint16_t attr,
+                                                 uint16_t selector,
+                                                 bool create) {
+    struct hostsim_dme_attr *entry;
+    uint32_t i;
+
+    for (i = 0; i < dme_attr_count; i++) {
+        entry = &dme_attrs[i];
+        if (entry->attr == attr && entry->selector == selector) {
+            return entry;
+        }
+    }
+
+    if (!create || dme_attr_count == HOSTSIM_DME_ATTRS_MAX) {
+        return NULL;
+    }
+
+    entry = &dme_attrs[dme_attr_count++];
+    entry->attr = attr;
+    entry->selector = selector;
+    entry->val = 0;
+    return entry;
+}
+
+int hostsim_dme_access(uint16_t attr,
+                       uint32_t *val,
+                       uint16_t selector,
+                       bool write) {
+    struct hostsim_dme_attr *entry;
+    struct hostsim_dme_attr *irq_status;
+
+    entry = hostsim_dme_find(attr, selector, write);
+    if (!write) {
+        *val = (entry != NULL) ? entry->val : 0;
+    } else if (entry != NULL) {
+        entry->val = *val;
+    } else {
+        fprintf(stderr, "hostsim: DME table full\n");
+        return HOSTSIM_DME_INVALID_MIB_ATTRIBUTE;
+    }
+
+    /*
+     * Mail raises the mailbox interrupt, and reading it clears the
+     * interrupt again: that is what the writer polls for in write_mailbox().
+     */
+    if (attr == ARA_MAILBOX) {
+        irq_status = hostsim_dme_find(ARA_INTERRUPTSTATUS, 0, true);
+        if (irq_status == NULL) {
+            return HOSTSIM_DME_INVALID_MIB_ATTRIBUTE;
+        }
+        if (write) {
+            irq_status->val |= ARA_INTERRUPTSTATUS_MAILBOX;
+        } else {
+            irq_status->val &= ~ARA_INTERRUPTSTATUS_MAILBOX;
+        }
+    }
+    return 0;
+}
+
+void hostsim_dme_init(void) {
+    uint32_t val;
+
+    dme_attr_count = 0;
+
+    /*
+     * The UniPro manufacturer ID is Toshiba's. The product ID is left at 0,
+     * preset it with -a for images whose TFTF header has one.
+     */
+    val = 0x0126;
+    hostsim_dme_access(DME_DDBL1_MANUFACTURERID, &val, 0, true);
+
+    val = POWERSTATE_LINKDOWN;
+    hostsim_dme_access(TSB_POWERSTATE, &val, 0, true);
+}
+
+/**
+ * @brief advertise the boot status
+ *
+ * A failed boot status ends the simulation: on the bridge, this is where
+ * halt_and_catch_fire() stops for good.
+ *
+ * @param boot_status
+ */
+void chip_advertise_boot_status(uint32_t boot_status) {
+    chip_unipro_attr_write(DME_ARA_INIT_STATUS, boot_status, 0, ATTR_LOCAL);
+
+    if (boot_status & INIT_STATUS_FAILED) {
+        printf("hostsim: boot failed, status 0x%08x\n", boot_status);
+        hostsim_exit(1);
+    }
+}
+
+uint32_t chip_get_boot_status(void) {
+    uint32_t boot_status = 0;
+
+    chip_unipro_attr_read(DME_ARA_INIT_STATUS, &boot_status, 0, ATTR_LOCAL);
+    return boot_status;
+}
+
+int chip_advertise_boot_type(void) {
+    return chip_unipro_attr_write(DME_ARA_INIT_TYPE, INIT_TYPE_TOSHIBA, 0,
+                                  ATTR_LOCAL);
+}
@@ -0,0 +1,294 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include "chip.h"
+#include "chipapi.h"
+#include "tsb_scm.h"
+#include "debug.h"
+#include "communication_area.h"
+#include "hostsim.h"
+
+/* the DWT cycle counter of the simulated bridge counts at the core clock */
+#define HOSTSIM_CORE_CLOCK_HZ   48000000ULL
+
+/*
+ * Like everything else, the stack the boot ROM code runs on is kept below
+ * 4GB, as pointers to locals get handled as uint32_t too.
+ */
+#define HOSTSIM_STACK_SIZE      (1024 * 1024)
+#ifdef MAP_32BIT
+#define HOSTSIM_MAP_LOW         MAP_32BIT
+#else
+#define HOSTSIM_MAP_LOW         0
+#endif
+
+void bootrom_main(void);
+
+struct hostsim_options hostsim_options = {
+    .link_path = HOSTSIM_LINK_PATH,
+};
+
+void hostsim_exit(int status) {
+    fflush(stdout);
+    exit(status);
+}
+
+/**
+ * @brief Map workram at its address on the bridge
+ *
+ * @returns 0 on success, <0 on error
+ */
+static int hostsim_workram_init(void) {
+    void *workram;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    int fd = -1;
+
+    if (hostsim_options.workram_file != NULL) {
+        fd = open(hostsim_options.workram_file, O_RDWR | O_CREAT, 0644);
+        if (fd < 0 || ftruncate(fd, WORKRAM_SIZE) != 0) {
+            perror(hostsim_options.workram_file);
+            return -1;
+        }
+        flags = MAP_SHARED;
+    }
+
+    workram = mmap((void *)WORKRAM_BASE, WORKRAM_SIZE,
+                   PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (workram != (void *)WORKRAM_BASE) {
+        fprintf(stderr, "hostsim: can't map workram at 0x%08x\n",
+                WORKRAM_BASE);
+        return -1;
+    }
+
+    if ((uintptr_t)&_communication_area + COMMUNICATION_AREA_LENGTH !=
+        WORKRAM_BASE + WORKRAM_SIZE) {
+        fprintf(stderr, "hostsim: communication area is not at the top of "
+                "workram, fix HOSTSIM_COMMUNICATION_AREA\n");
+        return -1;
+    }
+    return 0;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [-f flash.bin] [-w workram.bin] [-l socket] [-u]\n"
+            "          [-a attr=value]...\n"
+            "  -f  SPI flash image\n"
+            "  -w  file backing workram, to hand it over to a later stage\n"
+            "  -l  UNIX socket standing in for the UniPro link (default %s)\n"
+            "  -u  boot over UniPro (the bootselector SPIBOOT_N pin)\n"
+            "  -a  initial value of a local DME attribute\n",
+            name, HOSTSIM_LINK_PATH);
+}
+
+/**
+ * @brief Set a DME attribute from a -a attr=value option
+ *
+ * @returns 0 on success, <0 on a malformed option
+ */
+static int hostsim_preset_attr(const char *arg) {
+    char *end;
+    uint32_t attr;
+    uint32_t val;
+
+    attr = strtoul(arg, &end, 0);
+    if (*end != '=' || attr > UINT16_MAX) {
+        return -1;
+    }
+    val = strtoul(end + 1, &end, 0);
+    if (*end != '\0') {
+        return -1;
+    }
+    return hostsim_dme_access(attr, &val, 0, true) ? -1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    static ucontext_t main_context;
+    static ucontext_t bridge_context;
+    void *stack;
+    int opt;
+
+    hostsim_dme_init();
+
+    while ((opt = getopt(argc, argv, "f:w:l:ua:h")) != -1) {
+        switch (opt) {
+        case 'f':
+            hostsim_options.flash_image = optarg;
+            break;
+        case 'w':
+            hostsim_options.workram_file = optarg;
+            break;
+        case 'l':
+            hostsim_options.link_path = optarg;
+            break;
+        case 'u':
+            hostsim_options.boot_over_unipro = true;
+            break;
+        case 'a':
+            if (hostsim_preset_attr(optarg)) {
+                fprintf(stderr, "hostsim: bad attribute: %s\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (hostsim_workram_init() || hostsim_flash_init()) {
+        return 1;
+    }
+
+    stack = mmap(NULL, HOSTSIM_STACK_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | HOSTSIM_MAP_LOW, -1, 0);
+    if (stack == MAP_FAILED) {
+        perror("hostsim: stack");
+        return 1;
+    }
+
+    getcontext(&bridge_context);
+    bridge_context.uc_stack.ss_sp = stack;
+    bridge_context.uc_stack.ss_size = HOSTSIM_STACK_SIZE;
+    bridge_context.uc_link = &main_context;
+    makecontext(&bridge_context, bootrom_main, 0);
+    swapcontext(&main_context, &bridge_context);
+
+    hostsim_exit(0);
+}
+
+void chip_init(void) {
+#ifdef CONFIG_BRIDGED_SPI
+    chip_spi_master_init();
+#endif
+}
+
+void chip_dbginit(void) {
+}
+
+void chip_dbgputc(int c) {
+    putchar(c);
+}
+
+void chip_dbgflush(void) {
+    fflush(stdout);
+}
+
+uint32_t tsb_get_bootselector(void) {
+    return hostsim_options.boot_over_unipro ? TSB_EBOOTSELECTOR_SPIBOOT_N : 0;
+}
+
+int chip_validate_data_load_location(void *base, uint32_t length) {
+    if ((uint32_t)base < WORKRAM_BASE) {
+        return -1;
+    }
+    if ((uint32_t)base + length >= (uint32_t)&_communication_area) {
+        return -1;
+    }
+    return 0;
+}
+
+void chip_clear_image_loading_ram(void) {
+    memset((void *)WORKRAM_BASE, 0,
+           (uint32_t)&_communication_area - WORKRAM_BASE);
+}
+
+#ifdef _BOOT_PROFILE
+static uint64_t cycle_counter_base_ns;
+
+/**
+ * @brief Get the time since some fixed point, in ns
+ */
+static uint64_t hostsim_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Start counting host time as bridge core clock cycles
+ *
+ * The counter of an earlier stage is gone with its process, so it is always
+ * restarted.
+ *
+ * @param restart (ignored)
+ *
+ * @returns 0
+ */
+int chip_cycle_counter_start(bool restart) {
+    cycle_counter_base_ns = hostsim_ns();
+    return 0;
+}
+
+uint32_t chip_cycle_counter_read(void) {
+    return (uint32_t)((hostsim_ns() - cycle_counter_base_ns) *
+                      HOSTSIM_CORE_CLOCK_HZ / 1000000000ULL);
+}
+#endif
+
+void chip_delay(uint32_t delay) {
+    /* one delay unit is 200ns, see CHIP_NS_TO_DELAY */
+    uint64_t ns = (uint64_t)delay * 200;
+    struct timespec ts = {
+        .tv_sec = ns / 1000000000ULL,
+        .tv_nsec = ns % 1000000000ULL,
+    };
+
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * @brief "Jump" to the loaded image
+ *
+ * The image is bridge code, so this is where the simulation ends. With -w,
+ * the image and the communication area are left in the workram file.
+ */
+void chip_jump_to_image(uint32_t start_address) {
+    printf("hostsim: jump to image at 0x%08x\n", start_address);
+    hostsim_exit(0);
+}
+
+int chip_enter_standby(void) {
+    printf("hostsim: standby is not simulated\n");
+    return -1;
+}
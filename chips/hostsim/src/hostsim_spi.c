@@ -0,0 +1,176 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "chipapi.h"
+#include "debug.h"
+#include "data_loading.h"
+#include "crypto.h"
+#include "hostsim.h"
+
+/* the flash image, NULL when the flash is absent */
+static const uint8_t *flash;
+static uint32_t flash_size;
+
+static uint32_t current_addr;
+/* start of the image being loaded, which "fetch" offsets are relative to */
+static uint32_t image_addr;
+
+int hostsim_flash_init(void) {
+    struct stat st;
+    void *map;
+    int fd;
+
+    if (hostsim_options.flash_image == NULL) {
+        return 0;
+    }
+
+    fd = open(hostsim_options.flash_image, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(hostsim_options.flash_image);
+        return -1;
+    }
+    if (st.st_size == 0 || st.st_size > HOSTSIM_FLASH_SIZE_MAX) {
+        fprintf(stderr, "%s: flash images are 1 byte to %u bytes\n",
+                hostsim_options.flash_image, HOSTSIM_FLASH_SIZE_MAX);
+        close(fd);
+        return -1;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(hostsim_options.flash_image);
+        return -1;
+    }
+
+    flash = map;
+    flash_size = st.st_size;
+    return 0;
+}
+
+int hostsim_flash_set(const void *image, uint32_t size) {
+    if (size == 0 || size > HOSTSIM_FLASH_SIZE_MAX) {
+        return -1;
+    }
+
+    flash = image;
+    flash_size = size;
+    return 0;
+}
+
+void hostsim_flash_read(void *dest, uint32_t addr, uint32_t length) {
+    uint8_t *pdest = dest;
+    uint32_t chunk;
+
+    if (flash == NULL) {
+        /* nothing drives MISO */
+        memset(dest, 0xFF, length);
+        return;
+    }
+
+    while (length) {
+        addr %= flash_size;
+        chunk = flash_size - addr;
+        if (chunk > length) {
+            chunk = length;
+        }
+        memcpy(pdest, flash + addr, chunk);
+        pdest += chunk;
+        addr += chunk;
+        length -= chunk;
+    }
+}
+
+static int data_load_spi_init(void) {
+    current_addr = 0;
+    image_addr = 0;
+    return 0;
+}
+
+static int data_load_spi_load(void *dest, uint32_t length, bool hash) {
+    if (length == 0) {
+        return 0;
+    }
+
+    /* only 24bits of address in the SPI read command, as on the chip */
+    current_addr &= 0x00FFFFFF;
+    hostsim_flash_read(dest, current_addr, length);
+    current_addr = (current_addr + length) & 0x00FFFFFF;
+
+    if (hash) {
+        hash_update(dest, length);
+    }
+    return 0;
+}
+
+static int data_load_spi_read(void *dest, uint32_t addr, uint32_t length) {
+    current_addr = addr;
+    if (0 == length) {
+        image_addr = addr;
+        return 0;
+    }
+
+    return data_load_spi_load(dest, length, false);
+}
+
+static int data_load_spi_fetch(void *dest, uint32_t offset, uint32_t length) {
+    uint32_t saved_addr = current_addr;
+    int rc;
+
+    current_addr = image_addr + offset;
+    rc = data_load_spi_load(dest, length, false);
+    current_addr = saved_addr;
+    return rc;
+}
+
+static int data_load_spi_seek(uint32_t length) {
+    current_addr = (current_addr + length) & 0x00FFFFFF;
+    return 0;
+}
+
+static int data_load_spi_finish(bool valid, bool is_secure_image) {
+    return 0;
+}
+
+data_load_ops spi_ops = {
+    .init = data_load_spi_init,
+    .read = data_load_spi_read,
+    .load = data_load_spi_load,
+    .finish = data_load_spi_finish,
+    .fetch = data_load_spi_fetch,
+    .seek = data_load_spi_seek
+};
@@ -0,0 +1,243 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * This file implements the SPI device driver interface for Bridged-PHY SPI
+ * over Greybus, with a w25q16dw-like NOR flash on CS0 whose content is the
+ * flash image. Only what reading the flash takes is modelled: the flash is
+ * read-only and has no status bits to report.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+#include "appcfg.h"
+#include "chip.h"
+#include "debug.h"
+#include "nuttx_dev_if.h"
+#include "device_spi.h"
+#include "spi-gb.h"
+#include "utils.h"
+#include "hostsim.h"
+
+/* only support 1 device on CS0 */
+#define CONFIG_SPI_MAX_CHIPS 1
+
+/* only support 8 bits-per-word mode */
+#define CONFIG_SPI_BPW_MASK BIT(7)
+
+#define CONFIG_SPI_MIN_FREQ 15000
+#define CONFIG_SPI_MAX_FREQ 24000000
+
+#define FLASH_CMD_READ      0x03
+#define FLASH_CMD_FAST_READ 0x0B
+#define FLASH_CMD_RDSR      0x05
+#define FLASH_CMD_JEDEC_ID  0x9F
+
+/* Winbond, W25QxxDW, 16Mbit */
+static const uint8_t flash_jedec_id[] = {0xEF, 0x60, 0x15};
+
+/* see the note on the device name in es3_spi_master.c */
+static struct device_spi_cfg chips_info[CONFIG_SPI_MAX_CHIPS] = {
+    {0, 8, CONFIG_SPI_MAX_FREQ, "w25q16dw"},
+};
+
+/**
+ * @brief state of the flash command in progress, from select to deselect
+ */
+static struct hostsim_spi_flash {
+    bool selected;
+    uint8_t cmd;
+    /* bytes of the command shifted in so far, including the command byte */
+    uint32_t count;
+    uint32_t addr;
+} flash_state;
+
+static struct master_spi_caps spi_caps = {
+    .bpw = CONFIG_SPI_BPW_MASK,
+    .min_speed_hz = CONFIG_SPI_MIN_FREQ,
+    .max_speed_hz = CONFIG_SPI_MAX_FREQ,
+    .modes = (SPI_MODE_CPHA | SPI_MODE_CPOL),
+    .csnum = CONFIG_SPI_MAX_CHIPS,
+};
+
+static int hostsim_spi_select(struct device *dev, uint8_t devid) {
+    if (spi_caps.csnum <= devid) {
+        return -EINVAL;
+    }
+
+    memset(&flash_state, 0, sizeof(flash_state));
+    flash_state.selected = true;
+    return 0;
+}
+
+static int hostsim_spi_deselect(struct device *dev, uint8_t devid) {
+    if (spi_caps.csnum <= devid) {
+        return -EINVAL;
+    }
+
+    flash_state.selected = false;
+    return 0;
+}
+
+static int hostsim_spi_setfrequency(struct device *dev,
+                                    uint8_t cs,
+                                    uint32_t *frequency) {
+    if (spi_caps.csnum <= cs) {
+        return -EINVAL;
+    }
+
+    if (*frequency < CONFIG_SPI_MIN_FREQ ||
+        *frequency > chips_info[cs].max_speed_hz) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+static int hostsim_spi_setmode(struct device *dev, uint8_t cs, uint8_t mode) {
+    if (spi_caps.csnum <= cs) {
+        return -EINVAL;
+    }
+    /* check mode whether supported */
+    if (chips_info[cs].mode & ~mode) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+static int hostsim_spi_setbits(struct device *dev, uint8_t cs, uint8_t nbits) {
+    if (spi_caps.csnum <= cs) {
+        return -EINVAL;
+    }
+    if (chips_info[cs].bpw != nbits) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/**
+ * @brief Shift one byte through the flash
+ * @param tx byte from the master
+ * @return byte from the flash
+ */
+static uint8_t hostsim_spi_flash_shift(uint8_t tx) {
+    struct hostsim_spi_flash *f = &flash_state;
+    uint8_t rx = 0xFF;
+    uint32_t n = f->count++;
+
+    if (!f->selected) {
+        return rx;
+    }
+
+    if (n == 0) {
+        f->cmd = tx;
+        return rx;
+    }
+
+    switch (f->cmd) {
+    case FLASH_CMD_READ:
+    case FLASH_CMD_FAST_READ:
+        if (n <= 3) {
+            f->addr = (f->addr << 8) | tx;
+        } else if (f->cmd == FLASH_CMD_READ || n > 4) {
+            /* (FAST_READ has a dummy byte after the address) */
+            hostsim_flash_read(&rx, f->addr, 1);
+            f->addr = (f->addr + 1) & 0x00FFFFFF;
+        }
+        break;
+    case FLASH_CMD_RDSR:
+        /* never busy, never write enabled */
+        rx = 0;
+        break;
+    case FLASH_CMD_JEDEC_ID:
+        if (n <= sizeof(flash_jedec_id)) {
+            rx = flash_jedec_id[n - 1];
+        }
+        break;
+    default:
+        break;
+    }
+    return rx;
+}
+
+static int hostsim_spi_exchange(struct device *dev,
+                                struct device_spi_transfer *transfer) {
+    uint8_t *txbuf = transfer->txbuffer;
+    uint8_t *rxbuf = transfer->rxbuffer;
+    uint8_t rx;
+    size_t i;
+
+    /* check transfer buffer */
+    if (!txbuf && !rxbuf) {
+        return -EINVAL;
+    }
+
+    for (i = 0; i < transfer->nwords; i++) {
+        rx = hostsim_spi_flash_shift(txbuf ? txbuf[i] : 0);
+        if (rxbuf) {
+            rxbuf[i] = rx;
+        }
+    }
+    return 0;
+}
+
+static int hostsim_get_master_caps(struct device *dev,
+                                   struct master_spi_caps *caps) {
+    *caps = spi_caps;
+    return 0;
+}
+
+static int hostsim_get_device_cfg(struct device *dev,
+                                  uint8_t cs,
+                                  struct device_spi_cfg *dev_cfg) {
+    dev_cfg->mode = chips_info[cs].mode;
+    dev_cfg->bpw = chips_info[cs].bpw;
+    dev_cfg->max_speed_hz = chips_info[cs].max_speed_hz;
+    memcpy(dev_cfg->name, &chips_info[cs].name, sizeof(chips_info[cs].name));
+    return 0;
+}
+
+static struct device_spi_type_ops hostsim_spi_ops = {
+    .lock = NULL,      /* not used in this project */
+    .unlock = NULL,    /* not used in this project */
+    .select = hostsim_spi_select,
+    .deselect = hostsim_spi_deselect,
+    .setfrequency = hostsim_spi_setfrequency,
+    .setmode = hostsim_spi_setmode,
+    .setbits = hostsim_spi_setbits,
+    .exchange = hostsim_spi_exchange,
+    .get_master_caps = hostsim_get_master_caps,
+    .get_device_cfg = hostsim_get_device_cfg
+};
+
+void chip_spi_master_init(void) {
+    /* register device to greybus */
+    retister_spi_device((void *)&hostsim_spi_ops);
+}
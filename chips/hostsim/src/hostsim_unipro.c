@@ -0,0 +1,650 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "appcfg.h"
+#include "chipapi.h"
+#include "unipro.h"
+#include "tsb_dme.h"
+#include "debug.h"
+#include "hostsim.h"
+
+/*
+ * The link is a SOCK_SEQPACKET socket, so each packet is one CPort message
+ * or one DME access. gbboot_server builds play the switch end of the link
+ * and wait for a bridge to connect, the other apps are the bridge.
+ */
+enum hostsim_packet_type {
+    HOSTSIM_PACKET_CPORT,       /* a message, for CPort "id" */
+    HOSTSIM_PACKET_DME_GET,     /* peer DME access to attribute "id" */
+    HOSTSIM_PACKET_DME_SET,
+    HOSTSIM_PACKET_DME_RESULT,  /* answer to a DME get or set */
+};
+
+struct hostsim_packet_header {
+    uint16_t type;
+    uint16_t id;
+    uint16_t selector;
+    uint16_t result;            /* ConfigResultCode of a DME access */
+    uint32_t val;
+};
+
+struct hostsim_packet {
+    struct hostsim_packet_header header;
+    uint8_t data[HOSTSIM_CPORT_BUF_SIZE];
+};
+
+/* a message received for a CPort, waiting for chip_unipro_receive */
+struct hostsim_msg {
+    struct hostsim_msg *next;
+    uint64_t due_ns;            /* when it gets in, see hostsim_cport_ready */
+    size_t len;
+    uint8_t data[];
+};
+
+static struct hostsim_cport {
+    struct hostsim_msg *rx_head;
+    struct hostsim_msg *rx_tail;
+    size_t rx_header_len;       /* see chip_unipro_set_rx_placement */
+    unipro_rx_placement rx_placement;
+    uint8_t rx_buf[HOSTSIM_CPORT_BUF_SIZE] __attribute__ ((aligned(4)));
+    uint8_t tx_buf[HOSTSIM_CPORT_BUF_SIZE] __attribute__ ((aligned(4)));
+} cports[CPORT_MAX];
+
+static int link_fd = -1;
+
+/* the other end of the link, when it is in this process */
+static hostsim_peer_rx peer_rx;
+static uint32_t peer_latency_ns;
+
+/* answer to the peer DME access in progress */
+static bool dme_result_pending;
+static uint16_t dme_result;
+static uint32_t dme_result_val;
+
+/**
+ * @brief The link is gone: the peer is done, or died
+ */
+static void hostsim_link_down(void) {
+    printf("hostsim: link down\n");
+#ifdef BUILD_FOR_GBBOOT_SERVER
+    /* the bridge booted (or gave up), nothing left to serve */
+    hostsim_exit(0);
+#else
+    hostsim_exit(1);
+#endif
+}
+
+/**
+ * @brief Bring the link up, if it isn't yet
+ *
+ * Waits for the other end: the server for a bridge to connect, a bridge for
+ * a server to connect to.
+ */
+static void hostsim_link_up(void) {
+    struct sockaddr_un addr;
+    uint32_t val = POWERSTATE_LINKUP;
+    int fd;
+
+    if (link_fd >= 0 || peer_rx != NULL) {
+        return;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s",
+             hostsim_options.link_path);
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0) {
+        perror("hostsim: link");
+        hostsim_exit(1);
+    }
+
+#ifdef BUILD_FOR_GBBOOT_SERVER
+    unlink(addr.sun_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, 1) != 0) {
+        perror(addr.sun_path);
+        hostsim_exit(1);
+    }
+    printf("hostsim: waiting for a bridge on %s\n", addr.sun_path);
+    link_fd = accept(fd, NULL, NULL);
+    close(fd);
+    unlink(addr.sun_path);
+    if (link_fd < 0) {
+        perror("hostsim: link");
+        hostsim_exit(1);
+    }
+#else
+    while (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (errno != ENOENT && errno != ECONNREFUSED) {
+            perror(addr.sun_path);
+            hostsim_exit(1);
+        }
+        /* no server yet */
+        usleep(10000);
+    }
+    link_fd = fd;
+#endif
+
+    hostsim_dme_access(TSB_POWERSTATE, &val, 0, true);
+}
+
+/**
+ * @brief Send a packet over the link
+ * @param header packet header
+ * @param data CPort message, or NULL
+ * @param len size of the CPort message
+ */
+static void hostsim_link_send(struct hostsim_packet_header *header,
+                              const void *data,
+                              size_t len) {
+    struct iovec iov[2] = {
+        {.iov_base = header, .iov_len = sizeof(*header)},
+        {.iov_base = (void *)data, .iov_len = len},
+    };
+    struct msghdr msg = {
+        .msg_iov = iov,
+        .msg_iovlen = (data != NULL) ? 2 : 1,
+    };
+
+    hostsim_link_up();
+    if (sendmsg(link_fd, &msg, MSG_NOSIGNAL) < 0) {
+        hostsim_link_down();
+    }
+}
+
+static uint64_t hostsim_now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Check whether a CPort has a message in, not just on its way
+ */
+static bool hostsim_cport_ready(struct hostsim_cport *cport) {
+    return cport->rx_head != NULL &&
+           (cport->rx_head->due_ns == 0 ||
+            cport->rx_head->due_ns <= hostsim_now_ns());
+}
+
+/**
+ * @brief Sleep until the first message from the in-process peer gets in
+ * @return false if the peer has nothing on its way
+ */
+static bool hostsim_peer_wait(void) {
+    uint64_t due_ns = 0;
+    struct timespec ts;
+    uint32_t i;
+
+    for (i = 0; i < CPORT_MAX; i++) {
+        if (hostsim_cport_ready(&cports[i])) {
+            return true;
+        }
+        if (cports[i].rx_head != NULL &&
+            (due_ns == 0 || cports[i].rx_head->due_ns < due_ns)) {
+            due_ns = cports[i].rx_head->due_ns;
+        }
+    }
+    if (due_ns == 0) {
+        return false;
+    }
+
+    ts.tv_sec = due_ns / 1000000000ULL;
+    ts.tv_nsec = due_ns % 1000000000ULL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+           EINTR) {
+    }
+    return true;
+}
+
+/**
+ * @brief Queue a message received for a CPort
+ * @param due_ns when it gets in (CLOCK_MONOTONIC), 0 for right away
+ */
+static void hostsim_cport_queue(uint16_t cportid, const void *data,
+                                size_t len, uint64_t due_ns) {
+    struct hostsim_cport *cport;
+    struct hostsim_msg *msg;
+
+    if (cportid >= CPORT_MAX) {
+        dbgprintx32("hostsim: message for unknown cport ", cportid, "\n");
+        return;
+    }
+    cport = &cports[cportid];
+
+    msg = malloc(sizeof(*msg) + len);
+    if (msg == NULL) {
+        perror("hostsim: rx");
+        hostsim_exit(1);
+    }
+    msg->next = NULL;
+    msg->due_ns = due_ns;
+    msg->len = len;
+    memcpy(msg->data, data, len);
+
+    if (cport->rx_tail != NULL) {
+        cport->rx_tail->next = msg;
+    } else {
+        cport->rx_head = msg;
+    }
+    cport->rx_tail = msg;
+}
+
+/**
+ * @brief Handle a packet from the link
+ */
+static void hostsim_link_handle(struct hostsim_packet *packet, size_t len) {
+    struct hostsim_packet_header *header = &packet->header;
+
+    switch (header->type) {
+    case HOSTSIM_PACKET_CPORT:
+        hostsim_cport_queue(header->id, packet->data, len, 0);
+        break;
+    case HOSTSIM_PACKET_DME_GET:
+    case HOSTSIM_PACKET_DME_SET:
+        header->result = hostsim_dme_access(header->id, &header->val,
+                                            header->selector,
+                                            header->type ==
+                                                HOSTSIM_PACKET_DME_SET);
+        header->type = HOSTSIM_PACKET_DME_RESULT;
+        hostsim_link_send(header, NULL, 0);
+        break;
+    case HOSTSIM_PACKET_DME_RESULT:
+        dme_result = header->result;
+        dme_result_val = header->val;
+        dme_result_pending = false;
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Handle whatever came in over the link
+ * @param wait true to wait for at least one packet (bringing the link up
+ *             first if needed)
+ */
+static void hostsim_link_poll(bool wait) {
+    static struct hostsim_packet packet;
+    struct pollfd pfd;
+    ssize_t len;
+
+    if (peer_rx != NULL) {
+        /* whatever the peer sends is queued right away, due after its
+           latency */
+        if (wait && !hostsim_peer_wait()) {
+            printf("hostsim: waiting for a peer that has nothing to send\n");
+            hostsim_exit(1);
+        }
+        return;
+    }
+
+    if (wait) {
+        hostsim_link_up();
+    } else if (link_fd < 0) {
+        return;
+    }
+
+    pfd.fd = link_fd;
+    pfd.events = POLLIN;
+    while (poll(&pfd, 1, wait ? -1 : 0) > 0) {
+        len = recv(link_fd, &packet, sizeof(packet), 0);
+        if (len <= 0) {
+            hostsim_link_down();
+        }
+        if (len >= sizeof(packet.header)) {
+            hostsim_link_handle(&packet, len - sizeof(packet.header));
+        }
+        wait = false;
+    }
+}
+
+/**
+ * @brief Access a DME attribute of the peer
+ */
+static int hostsim_link_dme_access(uint16_t attr,
+                                   uint32_t *val,
+                                   uint16_t selector,
+                                   bool write) {
+    struct hostsim_packet_header header = {
+        .type = write ? HOSTSIM_PACKET_DME_SET : HOSTSIM_PACKET_DME_GET,
+        .id = attr,
+        .selector = selector,
+        .val = write ? *val : 0,
+    };
+
+    if (peer_rx != NULL) {
+        /* an in-process peer has no DME */
+        return HOSTSIM_DME_PEER_COMMUNICATION_FAILURE;
+    }
+
+    dme_result_pending = true;
+    hostsim_link_send(&header, NULL, 0);
+    while (dme_result_pending) {
+        hostsim_link_poll(true);
+    }
+
+    if (!write) {
+        *val = dme_result_val;
+    }
+    return dme_result;
+}
+
+int chip_unipro_attr_read(uint16_t attr,
+                          uint32_t *val,
+                          uint16_t selector,
+                          int peer) {
+    /* let what the peer did so far land in the local attributes */
+    hostsim_link_poll(false);
+
+    if (peer) {
+        return hostsim_link_dme_access(attr, val, selector, false);
+    }
+    return hostsim_dme_access(attr, val, selector, false);
+}
+
+int chip_unipro_attr_write(uint16_t attr,
+                           uint32_t val,
+                           uint16_t selector,
+                           int peer) {
+    hostsim_link_poll(false);
+
+    if (peer) {
+        return hostsim_link_dme_access(attr, &val, selector, true);
+    }
+    return hostsim_dme_access(attr, &val, selector, true);
+}
+
+/**
+ * @brief Drop whatever a CPort has received and reset its settings
+ */
+static void hostsim_reset_cport(struct hostsim_cport *cport) {
+    struct hostsim_msg *msg;
+
+    while (cport->rx_head != NULL) {
+        msg = cport->rx_head;
+        cport->rx_head = msg->next;
+        free(msg);
+    }
+    cport->rx_tail = NULL;
+    cport->rx_placement = NULL;
+}
+
+static void hostsim_reset_all_cports(void) {
+    uint32_t i;
+
+    for (i = 0; i < CPORT_MAX; i++) {
+        hostsim_reset_cport(&cports[i]);
+    }
+}
+
+void chip_unipro_init(void) {
+    hostsim_reset_all_cports();
+    dbgprint("Unipro enabled\n");
+}
+
+int chip_unipro_init_cport(uint32_t cportid) {
+    if (cportid >= CPORT_MAX) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+int chip_unipro_recv_cport(uint32_t *cportid) {
+    int rc;
+    uint32_t cport_recv = 0;
+
+    rc = read_mailbox(&cport_recv);
+    if (rc) {
+        return rc;
+    }
+    *cportid = --cport_recv;
+
+    if (cport_recv >= CPORT_MAX) {
+        return -EINVAL;
+    }
+
+    return ack_mailbox((uint16_t)(cport_recv + 1));
+}
+
+void chip_wait_for_link_up(void) {
+    hostsim_link_up();
+}
+
+void chip_reset_before_ready(void) {
+}
+
+void chip_reset_before_jump(void) {
+    hostsim_reset_all_cports();
+}
+
+void hostsim_set_peer(hostsim_peer_rx rx) {
+    uint32_t val = POWERSTATE_LINKUP;
+
+    peer_rx = rx;
+    if (rx != NULL) {
+        hostsim_dme_access(TSB_POWERSTATE, &val, 0, true);
+    }
+}
+
+void hostsim_set_peer_latency(uint32_t ns) {
+    peer_latency_ns = ns;
+}
+
+void hostsim_peer_send(uint16_t cportid, const void *data, size_t len) {
+    hostsim_cport_queue(cportid, data, len,
+                        peer_latency_ns ? hostsim_now_ns() + peer_latency_ns :
+                                          0);
+}
+
+int chip_unipro_send(unsigned int cportid,
+                     const void *header, size_t header_len,
+                     const void *payload, size_t payload_len) {
+    struct hostsim_packet_header packet = {
+        .type = HOSTSIM_PACKET_CPORT,
+        .id = cportid,
+    };
+    uint8_t *tx;
+
+    if (cportid >= CPORT_MAX || header_len > HOSTSIM_CPORT_BUF_SIZE ||
+        payload_len > HOSTSIM_CPORT_BUF_SIZE - header_len) {
+        return -1;
+    }
+
+    tx = cports[cportid].tx_buf;
+    memcpy(tx, header, header_len);
+    if (payload_len > 0) {
+        memcpy(tx + header_len, payload, payload_len);
+    }
+    if (peer_rx != NULL) {
+        peer_rx(cportid, tx, header_len + payload_len);
+        return 0;
+    }
+
+    hostsim_link_send(&packet, tx, header_len + payload_len);
+    return 0;
+}
+
+int chip_unipro_set_rx_placement(uint32_t cportid,
+                                 size_t header_len,
+                                 unipro_rx_placement placement) {
+    if (cportid >= CPORT_MAX ||
+        header_len == 0 || header_len >= HOSTSIM_CPORT_BUF_SIZE) {
+        return -EINVAL;
+    }
+#ifndef _UNIPRO_RX_PLACEMENT
+    /* same as the TSB driver: off unless the build asks for it */
+    if (placement != NULL) {
+        return -ENOTSUP;
+    }
+#endif
+
+    cports[cportid].rx_header_len = header_len;
+    cports[cportid].rx_placement = placement;
+    return 0;
+}
+
+/**
+ * @brief Hand the oldest message of a CPort to the handler
+ *
+ * With a placement callback, the message is split the way the TSB RX
+ * pause does it: the header goes to the RX buffer, the rest wherever the
+ * callback says.
+ *
+ * @return the handler's return value, <0 on error
+ */
+static int hostsim_cport_deliver(uint32_t cportid, unipro_rx_handler handler) {
+    struct hostsim_cport *cport = &cports[cportid];
+    struct hostsim_msg *msg = cport->rx_head;
+    size_t header_len = cport->rx_header_len;
+    size_t room;
+    void *dest;
+    int rc = 0;
+
+    cport->rx_head = msg->next;
+    if (cport->rx_head == NULL) {
+        cport->rx_tail = NULL;
+    }
+
+    if (cport->rx_placement != NULL && msg->len > header_len) {
+        memcpy(cport->rx_buf, msg->data, header_len);
+
+        room = HOSTSIM_CPORT_BUF_SIZE - header_len;
+        dest = cport->rx_placement(cportid, cport->rx_buf, &room);
+        if (dest == NULL) {
+            dest = cport->rx_buf + header_len;
+            room = HOSTSIM_CPORT_BUF_SIZE - header_len;
+        }
+        if (msg->len - header_len > room) {
+            rc = -1;
+        } else {
+            memcpy(dest, msg->data + header_len, msg->len - header_len);
+        }
+    } else if (msg->len > HOSTSIM_CPORT_BUF_SIZE) {
+        rc = -1;
+    } else {
+        memcpy(cport->rx_buf, msg->data, msg->len);
+    }
+
+    if (rc) {
+        dbgprint("Rx data overflow\n");
+    } else if (handler != NULL) {
+        rc = handler(cportid, cport->rx_buf, msg->len);
+    }
+    free(msg);
+    return rc;
+}
+
+int chip_unipro_receive(unsigned int cportid,
+                        unipro_rx_handler handler,
+                        bool blocking) {
+    if (cportid >= CPORT_MAX) {
+        return -1;
+    }
+
+    hostsim_link_poll(false);
+    while (!hostsim_cport_ready(&cports[cportid])) {
+        if (!blocking) {
+            return 0;
+        }
+        hostsim_link_poll(true);
+    }
+
+    return hostsim_cport_deliver(cportid, handler);
+}
+
+int chip_unipro_receive_ready(uint32_t cport_mask, unipro_rx_handler handler) {
+    uint32_t ready = 0;
+    uint32_t cportid;
+    int rc;
+
+    hostsim_link_poll(false);
+    for (cportid = 0; cportid < CPORT_MAX; cportid++) {
+        if (hostsim_cport_ready(&cports[cportid])) {
+            ready |= (1 << cportid);
+        }
+    }
+
+    /* one message per cport, as when the TSB RX status is read once */
+    ready &= cport_mask;
+    while (ready) {
+        cportid = 31 - __builtin_clz(ready);
+        ready &= ~(1 << cportid);
+
+        rc = hostsim_cport_deliver(cportid, handler);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+    return 0;
+}
+
+#ifdef _UNIPRO_WFI
+/* false to busy-poll like builds without _UNIPRO_WFI */
+static bool wfi_enabled = true;
+
+void hostsim_set_wfi(bool enable) {
+    wfi_enabled = enable;
+}
+
+bool chip_unipro_wait_event(void) {
+    uint32_t cportid;
+
+    if (!wfi_enabled) {
+        /* what chipapi.h has in place of this without _UNIPRO_WFI */
+        return false;
+    }
+
+    /* something already in, which the caller hasn't looked at yet */
+    for (cportid = 0; cportid < CPORT_MAX; cportid++) {
+        if (hostsim_cport_ready(&cports[cportid])) {
+            return true;
+        }
+    }
+
+    /* any packet may have been a DME access, so report one */
+    hostsim_link_poll(true);
+    return true;
+}
+#endif
@@ -48,6 +48,9 @@
 #define CHIP_IMAGE_LOADING_DEST(addr) ((unsigned char *)addr)
 
 #define MAX_TFTF_HEADER_SIZE_SUPPORTED 4096
+/* (a host build may take larger FFFF headers, see apps/bootbench) */
+#ifndef MAX_FFFF_HEADER_SIZE_SUPPORTED
 #define MAX_FFFF_HEADER_SIZE_SUPPORTED 4096
+#endif
 
 #endif /* __ARCH_ARM_TSB_CHIPCFG_H */
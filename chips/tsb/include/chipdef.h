@@ -100,6 +100,15 @@
 #define CM3UP_BASE      0xE000E000
 #define CM3UP_SIZE      0x1000
 
+/* NVIC registers (in CM3UP), for external interrupt number irq */
+#define NVIC_ISER(irq)  (CM3UP_BASE + 0x100 + (((irq) >> 5) << 2))
+#define NVIC_ICER(irq)  (CM3UP_BASE + 0x180 + (((irq) >> 5) << 2))
+#define NVIC_ICPR(irq)  (CM3UP_BASE + 0x280 + (((irq) >> 5) << 2))
+#define NVIC_IRQ_BIT(irq)   (1 << ((irq) & 31))
+
+/* External interrupt of the UniPro block */
+#define TSB_IRQ_UNIPRO  9
+
 #define ISAA_BASE       0x40084000
 #define ISAA_SIZE       0x1000
 
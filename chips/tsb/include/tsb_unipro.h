@@ -31,6 +31,7 @@
 
 #include "appcfg.h"
 #include "chip.h"
+#include "chipapi.h"
 #include "unipro.h"
 
 #include "tsb_unipro_hw.h"
@@ -64,6 +65,11 @@ struct cport {
     uint8_t *tx_buf;                /* TX region for this CPort */
     uint8_t *rx_buf;                /* RX region for this CPort */
     uint16_t cportid;
+#ifdef _UNIPRO_RX_PLACEMENT
+    uint16_t rx_header_len;         /* see chip_unipro_set_rx_placement */
+    unipro_rx_placement rx_placement;
+    bool rx_header_only;            /* RX paused after the header */
+#endif
 };
 
 extern struct cport cporttable[];
@@ -97,4 +103,8 @@ void tsb_reset_before_ready(void);
 
 void tsb_reset_before_jump(void);
 
+#ifdef _UNIPRO_WFI
+void tsb_unipro_enable_events(void);
+#endif
+
 #endif /* __ARCH_ARM_SRC_TSB_TSB_UNIPRO_H */
@@ -58,6 +58,7 @@
 #define AHM_RX_EOT_INT_AFT_0                   0x00000148
 #define AHM_RX_EOT_INT_AFT_1                   0x0000014C
 #define UNIPRO_INT_EN                          0x00000200
+    #define UNIPRO_INT_DME                     (1 << 0)
 #define AHS_TIMEOUT_INT_EN_0                   0x00000204
 #define AHS_TIMEOUT_INT_EN_1                   0x00000208
 #define AHM_HRESP_ERR_INT_EN_0                 0x0000020C
@@ -69,6 +70,7 @@
 #define CPB_RX_MSGST_ERR_INT_EN_0              0x0000022C
 #define CPB_RX_MSGST_ERR_INT_EN_1              0x00000230
 #define LUP_INT_EN                             0x00000234
+    #define LUP_INT_LINKUP                     (1 << 0)
 #define A2D_ATTRACS_INT_EN                     0x00000238
 #define AHM_RX_EOM_INT_EN_0                    0x0000023C
 #define AHM_RX_EOM_INT_EN_1                    0x00000240
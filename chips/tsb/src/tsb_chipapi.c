@@ -87,6 +87,47 @@ int chip_validate_data_load_location(void *base, uint32_t length) {
     return 0;
 }
 
+#ifdef _BOOT_PROFILE
+/* Cortex-M3 Data Watchpoint and Trace unit */
+#define ARMV7M_DEMCR            0xe000edfc
+#define DEMCR_TRCENA            (1 << 24)
+#define ARMV7M_DWT_CTRL         0xe0001000
+#define DWT_CTRL_CYCCNTENA      (1 << 0)
+#define DWT_CTRL_NOCYCCNT       (1 << 25)
+#define ARMV7M_DWT_CYCCNT       0xe0001004
+
+/**
+ * @brief Start the DWT cycle counter
+ *
+ * SysTick is not used as a fallback: it only has 24 bits and wraps every
+ * 350ms or so at 48MHz, which is shorter than a boot.
+ *
+ * @param restart true to restart counting from 0
+ *
+ * @returns 0 on success, -1 if the core has no cycle counter
+ */
+int chip_cycle_counter_start(bool restart) {
+    uint32_t ctrl;
+
+    putreg32(getreg32(ARMV7M_DEMCR) | DEMCR_TRCENA, ARMV7M_DEMCR);
+
+    ctrl = getreg32(ARMV7M_DWT_CTRL);
+    if (ctrl & DWT_CTRL_NOCYCCNT) {
+        return -1;
+    }
+
+    if (restart || !(ctrl & DWT_CTRL_CYCCNTENA)) {
+        putreg32(0, ARMV7M_DWT_CYCCNT);
+        putreg32(ctrl | DWT_CTRL_CYCCNTENA, ARMV7M_DWT_CTRL);
+    }
+    return 0;
+}
+
+uint32_t chip_cycle_counter_read(void) {
+    return getreg32(ARMV7M_DWT_CYCCNT);
+}
+#endif
+
 #ifdef _HANDSHAKE
  /**
   * @brief Perform a handshake with the external simulation controller
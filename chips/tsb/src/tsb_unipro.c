@@ -136,9 +136,73 @@ int tsb_unipro_init_cport(uint32_t cportid) {
 
     tsb_unipro_restart_rx(cport);
 
+#ifdef _UNIPRO_WFI
+    /* EOM, RX error and EOT (overflow, or end of the header when placing) */
+    tsb_unipro_write(AHM_RX_EOM_INT_EN_0,
+                     tsb_unipro_read(AHM_RX_EOM_INT_EN_0) |
+                     (0x03 << (cportid << 1)));
+    tsb_unipro_write(AHM_RX_EOT_INT_EN_0,
+                     tsb_unipro_read(AHM_RX_EOT_INT_EN_0) | (1 << cportid));
+#endif
+
     return 0;
 }
 
+#ifdef _UNIPRO_WFI
+/**
+ * @brief Let the UniPro events wake the core from WFI
+ *
+ * The interrupt is enabled in the NVIC but PRIMASK is kept set, so it is
+ * never taken (there are no handlers in the vector table). A pending
+ * interrupt still ends a WFI, which is all the boot loops need: they find
+ * out what happened from the status registers as they do when polling.
+ */
+void tsb_unipro_enable_events(void) {
+    __asm__ volatile ("cpsid i" ::: "memory");
+
+    tsb_unipro_write(UNIPRO_INT_EN, UNIPRO_INT_DME);
+    tsb_unipro_write(LUP_INT_EN, LUP_INT_LINKUP);
+    chip_unipro_attr_write(ARA_INTERRUPTENABLE, ARA_INTERRUPTSTATUS_MAILBOX, 0,
+                           ATTR_LOCAL);
+
+    putreg32(NVIC_IRQ_BIT(TSB_IRQ_UNIPRO), NVIC_ISER(TSB_IRQ_UNIPRO));
+}
+
+/**
+ * @brief Undo tsb_unipro_enable_events before handing over to the next stage
+ */
+static void tsb_unipro_disable_events(void) {
+    putreg32(NVIC_IRQ_BIT(TSB_IRQ_UNIPRO), NVIC_ICER(TSB_IRQ_UNIPRO));
+    putreg32(NVIC_IRQ_BIT(TSB_IRQ_UNIPRO), NVIC_ICPR(TSB_IRQ_UNIPRO));
+
+    tsb_unipro_write(AHM_RX_EOM_INT_EN_0, 0);
+    tsb_unipro_write(AHM_RX_EOT_INT_EN_0, 0);
+    tsb_unipro_write(LUP_INT_EN, 0);
+    tsb_unipro_write(UNIPRO_INT_EN, 0);
+
+    __asm__ volatile ("cpsie i" ::: "memory");
+}
+
+bool chip_unipro_wait_event(void) {
+    uint32_t dme;
+
+    /**
+     * The interrupt is level sensitive: if an event is still waiting to be
+     * handled, clearing the pending bit doesn't stick and WFI returns at
+     * once, so nothing is lost between the caller's last check and here.
+     */
+    putreg32(NVIC_IRQ_BIT(TSB_IRQ_UNIPRO), NVIC_ICPR(TSB_IRQ_UNIPRO));
+    __asm__ volatile ("dsb\n\twfi" ::: "memory");
+
+    tsb_unipro_write(LUP_INT_BEF, tsb_unipro_read(LUP_INT_BEF));
+    dme = tsb_unipro_read(UNIPRO_INT_BEF) & UNIPRO_INT_DME;
+    if (dme) {
+        tsb_unipro_write(UNIPRO_INT_BEF, dme);
+    }
+    return (dme != 0);
+}
+#endif
+
 /**
  * @brief Receive a dynamically-assigned CPort identifier
  */
@@ -176,11 +240,79 @@ void tsb_unipro_write(uint32_t offset, uint32_t v) {
 
 void tsb_unipro_restart_rx(struct cport *cport) {
     unsigned int cportid = cport->cportid;
+    uint32_t size = CPORT_RX_BUF_SIZE;
+
+#ifdef _UNIPRO_RX_PLACEMENT
+    /**
+     * With a placement callback, pause after the header so the callback can
+     * look at it before the rest of the message is written anywhere.
+     */
+    cport->rx_header_only = (cport->rx_placement != NULL);
+    if (cport->rx_header_only) {
+        size = cport->rx_header_len;
+    }
+#endif
 
     tsb_unipro_write(AHM_ADDRESS_00 + (cportid << 2), (uint32_t)cport->rx_buf);
     tsb_unipro_write(REG_RX_PAUSE_SIZE_00 + (cportid << 2),
-                 RX_PAUSE_RESTART | CPORT_RX_BUF_SIZE);
+                 RX_PAUSE_RESTART | size);
+}
+
+#ifdef _UNIPRO_RX_PLACEMENT
+/*
+ * In-place RX relies on two things of the CPort RX DMA that have only been
+ * exercised on hostsim so far, hence the _UNIPRO_RX_PLACEMENT switch: that a
+ * REG_RX_PAUSE_SIZE of the header length stops the DMA with an EOT in the
+ * middle of a message, and that writing AHM_ADDRESS and RX_PAUSE_RESTART
+ * then carries on with the same message at the new address.
+ */
+/**
+ * @brief Resume an RX paused after the header, wherever placement wants it
+ */
+static void tsb_unipro_place_rx(struct cport *cport) {
+    unsigned int cportid = cport->cportid;
+    size_t len = CPORT_RX_BUF_SIZE - cport->rx_header_len;
+    void *dest;
+
+    cport->rx_header_only = false;
+
+    dest = cport->rx_placement(cportid, cport->rx_buf, &len);
+    if (dest == NULL) {
+        dest = cport->rx_buf + cport->rx_header_len;
+        len = CPORT_RX_BUF_SIZE - cport->rx_header_len;
+    }
+
+    tsb_unipro_write(AHM_ADDRESS_00 + (cportid << 2), (uint32_t)dest);
+    tsb_unipro_write(REG_RX_PAUSE_SIZE_00 + (cportid << 2),
+                 RX_PAUSE_RESTART | len);
+}
+
+int chip_unipro_set_rx_placement(uint32_t cportid,
+                                 size_t header_len,
+                                 unipro_rx_placement placement) {
+    struct cport *cport;
+
+    if (header_len == 0 || header_len >= CPORT_RX_BUF_SIZE) {
+        return -EINVAL;
+    }
+
+    cport = cport_handle(cportid);
+    if (!cport) {
+        return -EINVAL;
+    }
+
+    cport->rx_header_len = header_len;
+    cport->rx_placement = placement;
+    return 0;
+}
+#else
+int chip_unipro_set_rx_placement(uint32_t cportid,
+                                 size_t header_len,
+                                 unipro_rx_placement placement) {
+    /* whole messages only, into the RX buffer */
+    return (placement == NULL) ? 0 : -ENOTSUP;
 }
+#endif
 
 /**
  * @brief Disable E2EFC on all CPorts
@@ -199,6 +331,9 @@ void tsb_reset_before_ready(void) {
 
 void tsb_reset_before_jump(void) {
     tsb_reset_all_cports();
+#ifdef _UNIPRO_WFI
+    tsb_unipro_disable_events();
+#endif
 }
 
 /**
@@ -211,22 +346,59 @@ void chip_wait_for_link_up(void) {
     do {
         rc = chip_unipro_attr_read(TSB_POWERSTATE, &tempval, 0,
                                    ATTR_LOCAL);
+        if (!rc && (tempval != POWERSTATE_LINKUP)) {
+            chip_unipro_wait_event();
+        }
     } while (!rc && (tempval != POWERSTATE_LINKUP));
 }
 
 /**
- * @brief send data down a CPort
+ * @brief Copy data into a CPort TX buffer
+ *
+ * The TX buffer is a window streaming to the CPort, not RAM: it is written
+ * once, in order, a word at a time where the data is aligned like the window.
+ *
+ * @param cport cport to send down
+ * @param offset where the data goes in the TX buffer
+ * @param data data to copy
+ * @param len size of the data
+ * @return the offset in the TX buffer behind the data
+ */
+static size_t tsb_unipro_tx_copy(struct cport *cport, size_t offset,
+                                 const uint8_t *data, size_t len) {
+    size_t i = 0;
+
+    if ((((uintptr_t)data | offset) & 3) == 0) {
+        for (; i + 4 <= len; i += 4) {
+            putreg32(*(const uint32_t *)&data[i], &cport->tx_buf[offset + i]);
+        }
+    }
+    for (; i < len; i++) {
+        putreg8(data[i], &cport->tx_buf[offset + i]);
+    }
+    return offset + len;
+}
+
+/**
+ * @brief send a message down a CPort
  * @param cportid cport to send down
- * @param buf data buffer
- * @param len size of data to send
+ * @param header first part of the message
+ * @param header_len size of the first part
+ * @param payload rest of the message, sent right behind the first part
+ * @param payload_len size of the rest
  * @param 0 on success, <0 on error
  */
-int chip_unipro_send(unsigned int cportid, const void *buf, size_t len) {
-    unsigned int i;
+int chip_unipro_send(unsigned int cportid,
+                     const void *header,
+                     size_t header_len,
+                     const void *payload,
+                     size_t payload_len) {
     struct cport *cport;
-    char *data = (char*)buf;
+    size_t offset;
 
-    if (cportid >= CPORT_MAX || len > CPORT_BUF_SIZE) {
+    if (cportid >= CPORT_MAX ||
+        header_len > CPORT_BUF_SIZE ||
+        payload_len > CPORT_BUF_SIZE - header_len) {
         return -1;
     }
 
@@ -235,12 +407,8 @@ int chip_unipro_send(unsigned int cportid, const void *buf, size_t len) {
         return -1;
     }
 
-    /*
-     * Data payload
-     */
-    for (i = 0; i < len; i++) {
-        putreg8(data[i], &cport->tx_buf[i]);
-    }
+    offset = tsb_unipro_tx_copy(cport, 0, header, header_len);
+    tsb_unipro_tx_copy(cport, offset, payload, payload_len);
 
     /* Hit EOM */
     putreg8(1, CPORT_EOM_BIT(cport));
@@ -248,16 +416,76 @@ int chip_unipro_send(unsigned int cportid, const void *buf, size_t len) {
     return 0;
 }
 
+/**
+ * @brief Handle whatever the RX status says happened on a cport
+ * @param cport cport to look at
+ * @param eom value of AHM_RX_EOM_INT_BEF_0
+ * @param eot value of AHM_RX_EOT_INT_BEF_0
+ * @param handler rx handler callback, called before RX is restarted
+ * @param received set to true if a whole message was handed to the handler
+ * @return 0 or the handler's return value if a message was received,
+ *         <0 on error
+ */
+static int tsb_unipro_rx_event(struct cport *cport,
+                               uint32_t eom,
+                               uint32_t eot,
+                               unipro_rx_handler handler,
+                               bool *received) {
+    uint32_t cportid = cport->cportid;
+    uint32_t bytes_received;
+    int rc = 0;
+
+    uint32_t eom_nom_bit = (0x01 << (cportid << 1));
+    uint32_t eom_err_bit = (0x02 << (cportid << 1));
+    uint32_t eot_bit = (1 << cportid);
+
+    *received = false;
+
+    if ((eom & eom_err_bit) != 0) {
+        dbgprintx32("UniPro cport ", cportid, " Rx err\n");
+        return -1;
+    }
+    if ((eot & eot_bit) != 0) {
+#ifdef _UNIPRO_RX_PLACEMENT
+        if (!cport->rx_header_only) {
+            dbgprint("Rx data overflow\n");
+            return -1;
+        }
+
+        /* the header is in, decide where the rest of the message goes */
+        tsb_unipro_write(AHM_RX_EOT_INT_BEF_0, eot_bit);
+        if ((eom & eom_nom_bit) == 0) {
+            tsb_unipro_place_rx(cport);
+            return 0;
+        }
+        /* (the message was just a header) */
+#else
+        dbgprint("Rx data overflow\n");
+        return -1;
+#endif
+    }
+    if ((eom & eom_nom_bit) != 0) {
+        bytes_received = tsb_unipro_read(CPB_RX_TRANSFERRED_DATA_SIZE_00 +
+                                         (cportid << 2));
+        tsb_unipro_write(AHM_RX_EOM_INT_BEF_0, eom_nom_bit);
+
+        if (handler != NULL) {
+            rc = handler(cportid,
+                         cport->rx_buf,
+                         bytes_received);
+        }
+        tsb_unipro_restart_rx(cport);
+        *received = true;
+    }
+    return rc;
+}
+
 int chip_unipro_receive(unsigned int cportid,
                         unipro_rx_handler handler,
                         bool blocking) {
-    uint32_t bytes_received;
-    int rc = 0;
+    int rc;
     struct cport *cport;
-
-    uint32_t eom_nom_bit;
-    uint32_t eom_err_bit;
-    uint32_t eot_bit;
+    bool received;
 
     uint32_t eom;
     uint32_t eot;
@@ -271,31 +499,54 @@ int chip_unipro_receive(unsigned int cportid,
         eom = tsb_unipro_read(AHM_RX_EOM_INT_BEF_0);
         eot = tsb_unipro_read(AHM_RX_EOT_INT_BEF_0);
 
-        eom_nom_bit = (0x01 << (cportid << 1));
-        eom_err_bit = (0x02 << (cportid << 1));
-        eot_bit = (1 << cportid);
-
-        if ((eom & eom_err_bit) != 0) {
-            dbgprintx32("UniPro cport ", cportid, " Rx err\n");
-            return -1;
+        rc = tsb_unipro_rx_event(cport, eom, eot, handler, &received);
+        if (rc < 0 || received) {
+            return rc;
         }
-        if ((eot & eot_bit) != 0) {
-            dbgprint("Rx data overflow\n");
+    } while(blocking);
+    return 0;
+}
+
+/**
+ * @brief Fold the 2-bit-per-cport EOM status into one bit per cport
+ * @param eom value of AHM_RX_EOM_INT_BEF_0
+ * @return bit n set if cport n has either its EOM or its error bit set
+ */
+static uint32_t tsb_unipro_eom_cports(uint32_t eom) {
+    eom = (eom | (eom >> 1)) & 0x55555555;
+    eom = (eom | (eom >> 1)) & 0x33333333;
+    eom = (eom | (eom >> 2)) & 0x0F0F0F0F;
+    eom = (eom | (eom >> 4)) & 0x00FF00FF;
+    return (eom | (eom >> 8)) & 0x0000FFFF;
+}
+
+int chip_unipro_receive_ready(uint32_t cports, unipro_rx_handler handler) {
+    int rc;
+    struct cport *cport;
+    bool received;
+    uint32_t cportid;
+
+    uint32_t eom;
+    uint32_t eot;
+    uint32_t ready;
+
+    eom = tsb_unipro_read(AHM_RX_EOM_INT_BEF_0);
+    eot = tsb_unipro_read(AHM_RX_EOT_INT_BEF_0);
+
+    ready = (tsb_unipro_eom_cports(eom) | eot) & cports;
+    while (ready) {
+        cportid = 31 - __builtin_clz(ready);
+        ready &= ~(1 << cportid);
+
+        cport = cport_handle(cportid);
+        if (!cport) {
             return -1;
         }
-        if ((eom & eom_nom_bit) != 0) {
-            bytes_received = tsb_unipro_read(CPB_RX_TRANSFERRED_DATA_SIZE_00 +
-                                             (cportid << 2));
-            tsb_unipro_write(AHM_RX_EOM_INT_BEF_0, eom_nom_bit);
-
-            if (handler != NULL) {
-                rc = handler(cportid,
-                             cport->rx_buf,
-                             bytes_received);
-            }
-            tsb_unipro_restart_rx(cport);
+
+        rc = tsb_unipro_rx_event(cport, eom, eot, handler, &received);
+        if (rc != 0) {
             return rc;
         }
-    } while(blocking);
-    return rc;
+    }
+    return 0;
 }
@@ -47,6 +47,7 @@
 /*
  * Switch attributes and related values
  */
+#define ARA_INTERRUPTENABLE        0xd080
 #define ARA_INTERRUPTSTATUS        0xd081
     #define ARA_INTERRUPTSTATUS_MAILBOX (1 << 15)
 #define ARA_MAILBOX                0xa000
@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __COMMON_INCLUDE_BOOT_PROFILE_H
+#define __COMMON_INCLUDE_BOOT_PROFILE_H
+
+#include <stdint.h>
+#include "debug.h"
+#include "communication_area.h"
+
+#ifdef _BOOT_PROFILE
+/**
+ * @brief Start profiling the current boot stage
+ *
+ * The boot ROM starts the cycle counter and clears the profile in the
+ * communication area. Later stages keep both, so their events follow the
+ * ones of the earlier stages. Records a BOOT_PHASE_ENTRY event.
+ */
+void boot_profile_init(void);
+
+/**
+ * @brief Record the end of a boot phase
+ *
+ * @param phase The boot phase that just ended
+ * @param arg Phase specific detail, such as the TFTF section index
+ */
+void boot_profile_mark(boot_phase phase, uint16_t arg);
+#else
+#define boot_profile_init()
+#define boot_profile_mark(phase, arg)
+#endif
+
+#endif /* __COMMON_INCLUDE_BOOT_PROFILE_H */
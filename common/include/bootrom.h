@@ -43,6 +43,8 @@ extern uint32_t ara_pid;
 int locate_ffff_element_on_storage(data_load_ops *ops,
                                    uint32_t type,
                                    uint32_t *length);
+int locate_next_ffff_element(data_load_ops *ops, uint32_t *length);
+int get_ffff_element_location(uint32_t *location);
 
 typedef void (*image_entry_func)(void);
 
@@ -65,6 +65,21 @@ void chip_handshake_boot_status(uint32_t status);
 
 int chip_validate_data_load_location(void *base, uint32_t length);
 
+#ifdef _BOOT_PROFILE
+/**
+ * @brief start the free-running cycle counter used for boot profiling
+ * @param restart true to restart counting from 0, false to keep a counter
+ *                that an earlier boot stage already started
+ * @return 0 on success, <0 if the chip has no usable cycle counter
+ */
+int chip_cycle_counter_start(bool restart);
+
+/**
+ * @brief read the cycle counter started by chip_cycle_counter_start
+ */
+uint32_t chip_cycle_counter_read(void);
+#endif
+
 void chip_reset_before_jump(void);
 void chip_jump_to_image(uint32_t start_address);
 
@@ -105,13 +120,22 @@ int chip_unipro_attr_write(uint16_t attr,
                            int peer);
 
 /**
- * @brief send data down a CPort
+ * @brief send a message down a CPort
  * @param cportid cport to send down
- * @param buf data buffer
- * @param len size of data to send
+ * @param header first part of the message (e.g. a Greybus header)
+ * @param header_len size of the first part
+ * @param payload rest of the message, sent right behind the first part
+ *                (may be NULL if payload_len is 0)
+ * @param payload_len size of the rest
  * @return 0 on success, <0 on error
+ * @NOTE: both parts go out as one message, so callers don't need to copy
+ *        the payload behind the header first
  */
-int chip_unipro_send(unsigned int cportid, const void *buf, size_t len);
+int chip_unipro_send(unsigned int cportid,
+                     const void *header,
+                     size_t header_len,
+                     const void *payload,
+                     size_t payload_len);
 
 /**
  * @brief handler callback for UniPro data RX
@@ -156,6 +180,65 @@ static inline int unipro_receive_blocking(unsigned int cportid,
     return chip_unipro_receive(cportid, handler, true);
 }
 
+/**
+ * @brief receive on the cports that have data, without waiting
+ * @param cports bit mask of the cports to look at (bit n for cport n)
+ * @param handler rx handler callback, called before RX is restarted
+ * @return as chip_unipro_receive, for the first cport on which the handler
+ *         returned non-zero (the others are left for the next call)
+ * @NOTE: the RX status is read once for all cports, rather than once per
+ *        cport as a loop over chip_unipro_receive would
+ */
+int chip_unipro_receive_ready(uint32_t cports, unipro_rx_handler handler);
+
+/**
+ * @brief sleep until UniPro has something for us
+ *
+ * Wakes up on RX on an initialized cport, on link up, or on a DME interrupt
+ * (which is how mail from the SVC is signalled). It may also return early
+ * for an event that was already handled, so callers check their condition
+ * again in a loop.
+ * @return true if a DME interrupt was seen, so the mailbox may have mail
+ * @NOTE: without _UNIPRO_WFI it returns at once and callers just poll
+ */
+#ifdef _UNIPRO_WFI
+bool chip_unipro_wait_event(void);
+#else
+static inline bool chip_unipro_wait_event(void) {
+    return false;
+}
+#endif
+
+/**
+ * @brief placement callback for UniPro data RX
+ * @param cportid cport which is receiving data
+ * @param header the first bytes of the message, already in the RX buffer
+ * @param len on entry, the room left in the RX buffer behind the header;
+ *            on return, the number of bytes to receive at the returned address
+ * @return where the rest of the message should be written, or NULL to
+ *         receive it into the RX buffer behind the header
+ */
+typedef void *(*unipro_rx_placement)(uint32_t cportid,
+                                     void *header,
+                                     size_t *len);
+
+/**
+ * @brief let the caller choose where the rest of each message on a cport goes
+ * @param cportid cport to configure
+ * @param header_len number of bytes received into the RX buffer before
+ *                   placement is called
+ * @param placement placement callback, or NULL to receive whole messages into
+ *                  the RX buffer again
+ * @return 0 on success, <0 on error
+ * @NOTE: The setting takes effect from the message after the one currently
+ *        being received. The handler passed to chip_unipro_receive still gets
+ *        the RX buffer, which then only holds the header if the rest of the
+ *        message was placed elsewhere.
+ */
+int chip_unipro_set_rx_placement(uint32_t cportid,
+                                 size_t header_len,
+                                 unipro_rx_placement placement);
+
 /**
  * @brief advertise the boot status to the switch
  * @param boot_status
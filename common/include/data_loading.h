@@ -54,9 +54,23 @@ typedef int (*data_loading_init)(void);
  *
  * The "hash" parameter indicates if the "load" function should call
  * "hash_update" to calculate the hash of data beling loaded.
+ *
+ * "fetch" reads data at an offset from the start of the image (the address
+ * set by "init" or by the last 0-length "read") without moving the position
+ * of the next "load" and without hashing. It lets a parser look ahead, e.g.
+ * at the signature of a TFTF, while the image is still being loaded in
+ * order. Methods that cannot do this set it to NULL.
+ *
+ * "seek" moves the position of the next "load" forward by "length" bytes
+ * without transferring the data in between, for data that is neither kept
+ * nor hashed. Methods that cannot skip data set it to NULL, and the data is
+ * loaded and thrown away instead.
  */
 typedef int (*data_loading_read)(void *dest, uint32_t addr, uint32_t length);
 typedef int (*data_loading_load)(void *dest, uint32_t length, bool hash);
+typedef int (*data_loading_fetch)(void *dest, uint32_t offset,
+                                  uint32_t length);
+typedef int (*data_loading_seek)(uint32_t length);
 
 typedef int (*data_loading_finish)(bool valid, bool is_secure_image);
 
@@ -65,6 +79,8 @@ typedef struct {
     data_loading_read read;
     data_loading_load load;
     data_loading_finish finish;
+    data_loading_fetch fetch;
+    data_loading_seek seek;
 } data_load_ops;
 
 #endif /* __COMMON_INCLUDE_DATA_LOADING_H */
@@ -32,6 +32,17 @@
 #ifndef __COMMON_INCLUDE_GBFIRMWARE_H
 #define __COMMON_INCLUDE_GBFIRMWARE_H
 
+/* Greybus FirmWare protocol version we support */
+#define GB_BOOT_VERSION_MAJOR         0x00
+#define GB_BOOT_VERSION_MINOR         0x02
+
+/**
+ * First protocol version whose GET_FIRMWARE requests may ask for up to
+ * GB_LARGE_PAYLOAD_SIZE bytes. Older peers are limited to GB_MAX_PAYLOAD_SIZE.
+ */
+#define GB_BOOT_VERSION_LARGE_MAJOR   0x00
+#define GB_BOOT_VERSION_LARGE_MINOR   0x02
+
 /* Greybus FirmWare request types */
 #define GB_BOOT_OP_INVALID            0x00
 #define GB_BOOT_OP_PROTOCOL_VERSION   0x01
@@ -67,7 +78,7 @@ struct __attribute__ ((__packed__)) gbboot_firmware_size_request {
 };
 
 struct __attribute__ ((__packed__)) gbboot_firmware_size_response {
-  size_t size;
+  uint32_t size;
 };
 
 struct __attribute__ ((__packed__)) gbboot_get_firmware_request {
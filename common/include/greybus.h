@@ -70,6 +70,11 @@ static inline int gb_operation_request_size(gb_operation_header *header) {
 
 /* GB_MAX_PAYLOAD_SIZE = 0x800 - 2 * sizeof(gb_operation_header) */
 #define GB_MAX_PAYLOAD_SIZE          (0x7F0)
+/**
+ * Payload limit for peers that agreed to use the whole 8KB CPort buffer.
+ * GB_LARGE_PAYLOAD_SIZE = 0x2000 - 2 * sizeof(gb_operation_header)
+ */
+#define GB_LARGE_PAYLOAD_SIZE        (0x1FF0)
 
 #define CONTROL_CPORT 0
 
@@ -118,5 +123,6 @@ int greybus_init(void);
 void greybus_register_handlers(uint32_t cportid,
                                greybus_op_handler *handlers);
 int greybus_loop(void);
+void greybus_get_poll_stats(uint32_t *polls, uint32_t *messages);
 
 #endif /* __COMMON_INCLUDE_GREYBUS_H */
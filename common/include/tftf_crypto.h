@@ -44,4 +44,7 @@ typedef char ___key_name_test[(sizeof (___test_signature.key_name) ==
                               1 : -1];
 
 int verify_signature(unsigned char *digest, tftf_signature *signature);
+int verify_signature_start(tftf_signature *signature);
+void verify_signature_step(void);
+int verify_signature_finish(unsigned char *digest, tftf_signature *signature);
 #endif /* __COMMON_INCLUDE_TFTF_CRYPTO_H */
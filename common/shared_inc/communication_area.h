@@ -55,6 +55,12 @@ typedef struct {
 #define S2_KEY_NAMELENGTH   96
 #define RESUME_ADDR_LENGTH  (sizeof(resume_address_communication_area))
 
+/*
+ * Functions the boot ROM shares with the later stages. This table is part of
+ * the mask ROM ABI: a later stage must find these at the same place whatever
+ * boot ROM it runs on, so it never changes. New functions are shared through
+ * the extension table (shared_function_ext_index) instead.
+ */
 typedef enum {
     SHARED_FUNCTION_SHA256_INIT,
     SHARED_FUNCTION_SHA256_PROCESS,
@@ -64,7 +70,114 @@ typedef enum {
     NUMBER_OF_SHARED_FUNCTIONS
 } shared_function_index;
 
+/* Compile-time test hack: the mask ROM shares exactly these */
+typedef char ___shared_functions_test[(NUMBER_OF_SHARED_FUNCTIONS == 5) ?
+                                      1 : -1];
+
+/*
+ * Functions shared by boot ROMs that are newer than the table above.
+ *
+ * The extension table sits right before shared_functions. Its magic and the
+ * number of entries the boot ROM filled in are nearest to shared_functions,
+ * and the entries are stored from the end: a new function is added at the end
+ * of this enum and takes the next lower address, so no entry ever moves.
+ * There is no such function if the boot ROM predates the table (no magic) or
+ * this function (index beyond the count).
+ */
+typedef enum {
+    SHARED_FUNCTION_EXT_SHA256_PROCESS_BLOCK,
+    SHARED_FUNCTION_EXT_RSA2048_VERIFY_MONT,
+    SHARED_FUNCTION_EXT_RSA2048_POW_START,
+    SHARED_FUNCTION_EXT_RSA2048_POW_STEP,
+    SHARED_FUNCTION_EXT_RSA2048_POW_CHECK,
+    NUMBER_OF_SHARED_FUNCTIONS_EXT
+} shared_function_ext_index;
+
+#define SHARED_FUNCTIONS_EXT_MAGIC  0x58454653  /* "SFEX" */
+
+typedef struct {
+    void * functions[NUMBER_OF_SHARED_FUNCTIONS_EXT]; /* last index first */
+    uint32_t count;
+    uint32_t magic;
+} __attribute__ ((packed)) shared_functions_ext_table;
+
+/*
+ * Boot phase profile (built with _BOOT_PROFILE=1)
+ *
+ * Each stage appends an event when one of its boot phases ends, stamped with
+ * the Cortex-M3 cycle counter. The counter is started by the boot ROM and
+ * keeps running across the jumps to the later stages, so the duration of a
+ * phase is the difference to the previous event.
+ */
+typedef enum {
+    BOOT_PHASE_ENTRY,           /* stage started, after chip_init */
+    BOOT_PHASE_UNIPRO_INIT,
+    BOOT_PHASE_EFUSE_INIT,
+    BOOT_PHASE_LOAD_INIT,       /* data_load_ops init (incl. wait for AP) */
+    BOOT_PHASE_LOCATE_FFFF,
+    BOOT_PHASE_TFTF_HEADER,
+    BOOT_PHASE_TFTF_SECTION,    /* arg: section index */
+    BOOT_PHASE_HASH_FINAL,
+    BOOT_PHASE_VERIFY_SIGNATURE,
+    BOOT_PHASE_JUMP,
+    NUMBER_OF_BOOT_PHASES
+} boot_phase;
+
+#define BOOT_PROFILE_MAX_EVENTS 32
+
+typedef struct {
+    uint32_t cycles;
+    uint8_t  stage;
+    uint8_t  phase;
+    uint16_t arg;
+} __attribute__ ((packed)) boot_profile_event;
+
+typedef struct {
+    uint16_t num_events;
+    uint16_t lost_events;       /* marks dropped because events[] was full */
+    boot_profile_event events[BOOT_PROFILE_MAX_EVENTS];
+} __attribute__ ((packed)) boot_profile_data;
+
+/*
+ * FFFF hand-off
+ *
+ * The boot ROM leaves here the FFFF header it found and validated on SPI
+ * flash, so that the later stages do not search for and validate the headers
+ * again. A later stage reads header_size bytes at header_address in one go,
+ * and uses them as the FFFF header if their SHA256 is header_digest.
+ *
+ * The element index lists the elements of that header (type and generation,
+ * and their slot in the header's element table), for the later stage to pick
+ * its own without going through the whole table. number_of_elements is
+ * FFFF_HANDOFF_NOT_INDEXED if the table has too many elements for the index.
+ */
+#define FFFF_HANDOFF_MAGIC          0x48464646  /* "FFFH" */
+#define FFFF_HANDOFF_DIGEST_SIZE    32          /* SHA256 */
+#define FFFF_HANDOFF_MAX_ELEMENTS   16
+#define FFFF_HANDOFF_NOT_INDEXED    0xFFFF
+
+typedef struct {
+    uint16_t slot;
+    uint8_t  type;
+    uint8_t  reserved;
+    uint32_t generation;
+} __attribute__ ((packed)) ffff_handoff_element;
+
+typedef struct {
+    uint32_t magic;             /* FFFF_HANDOFF_MAGIC when filled in */
+    uint32_t header_address;
+    uint32_t header_size;
+    uint32_t header_generation;
+    unsigned char header_digest[FFFF_HANDOFF_DIGEST_SIZE];
+    uint16_t number_of_elements;
+    uint16_t reserved;
+    ffff_handoff_element elements[FFFF_HANDOFF_MAX_ELEMENTS];
+} __attribute__ ((packed)) ffff_handoff_data;
+
 #define COMMUNICATION_AREA_DATA_FIELDS \
+    ffff_handoff_data ffff_handoff; \
+    boot_profile_data boot_profile; \
+    shared_functions_ext_table shared_functions_ext; \
     void * shared_functions[NUMBER_OF_SHARED_FUNCTIONS]; \
     unsigned char endpoint_unique_id[EUID_LENGTH]; \
     unsigned char stage_2_firmware_identity[S2_FW_ID_LENGTH]; \
@@ -108,4 +221,44 @@ static inline void set_shared_function(shared_function_index index,
     p->shared_functions[index] = func;
 }
 
+/**
+ * @brief Start sharing the extension table, with no function in it yet
+ *
+ * To be called by the boot ROM before set_shared_function_ext.
+ */
+static inline void init_shared_functions_ext(void) {
+    communication_area *p = (communication_area *)&_communication_area;
+    uint32_t i;
+
+    for (i = 0; i < NUMBER_OF_SHARED_FUNCTIONS_EXT; i++) {
+        p->shared_functions_ext.functions[i] = NULL;
+    }
+    p->shared_functions_ext.count = NUMBER_OF_SHARED_FUNCTIONS_EXT;
+    p->shared_functions_ext.magic = SHARED_FUNCTIONS_EXT_MAGIC;
+}
+
+static inline void *get_shared_function_ext(shared_function_ext_index index) {
+    communication_area *p = (communication_area *)&_communication_area;
+
+    if (p->shared_functions_ext.magic != SHARED_FUNCTIONS_EXT_MAGIC ||
+        index >= p->shared_functions_ext.count ||
+        index >= NUMBER_OF_SHARED_FUNCTIONS_EXT) {
+        return NULL;
+    }
+    return p->shared_functions_ext.functions[NUMBER_OF_SHARED_FUNCTIONS_EXT -
+                                             1 - index];
+}
+
+static inline void set_shared_function_ext(shared_function_ext_index index,
+                                           void *func) {
+    if (index >= NUMBER_OF_SHARED_FUNCTIONS_EXT) {
+        dbgprint("shared-fn index too big\n");
+        return;
+    }
+
+    communication_area *p = (communication_area *)&_communication_area;
+    p->shared_functions_ext.functions[NUMBER_OF_SHARED_FUNCTIONS_EXT -
+                                      1 - index] = func;
+}
+
 #endif /* __COMMON_INCLUDE__COMMUNICATION_AREA_H */
@@ -45,6 +45,25 @@ typedef struct {
 extern const crypto_public_key public_keys[];
 extern const uint32_t number_of_public_keys;
 
+#define RSA2048_PUBLIC_KEY_WORDS (RSA2048_PUBLIC_KEY_SIZE / sizeof(uint32_t))
+
+/**
+ * Precomputed Montgomery constants of an RSA2048 public key, so that
+ * signature verification can skip all of the per-key setup. The numbers are
+ * little-endian arrays of 32-bit words. An n0 of 0 means "not precomputed".
+ *
+ * public_keys_mont[k] belongs to public_keys[k]. It is generated from the
+ * public keys file at build time (see tools/pubkey_mont.c).
+ */
+typedef struct {
+    uint32_t n0;                                /* -1/modulus mod 2^32 */
+    uint32_t modulus[RSA2048_PUBLIC_KEY_WORDS];
+    uint32_t r2[RSA2048_PUBLIC_KEY_WORDS];      /* 2^4096 mod modulus */
+} crypto_public_key_mont;
+
+extern const crypto_public_key_mont public_keys_mont[];
+extern const uint32_t number_of_public_keys_mont;
+
 void crypto_init(void);
 
 void hash_start(void);
@@ -74,6 +74,9 @@ int read_mailbox(uint32_t *val) {
     do {
         rc = chip_unipro_attr_read(ARA_INTERRUPTSTATUS, &irq_status, 0,
                                    ATTR_LOCAL);
+        if (!rc && !(irq_status & ARA_INTERRUPTSTATUS_MAILBOX)) {
+            chip_unipro_wait_event();
+        }
     } while (!rc && !(irq_status & ARA_INTERRUPTSTATUS_MAILBOX));
     if (rc) {
         return rc;
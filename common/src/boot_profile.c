@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chipapi.h"
+#include "debug.h"
+#include "boot_profile.h"
+
+#ifdef _BOOT_PROFILE
+
+/* set once boot_profile_init has started the cycle counter */
+static bool profile_enabled = false;
+
+void boot_profile_init(void) {
+    communication_area *p = (communication_area *)&_communication_area;
+
+#if BOOT_STAGE == 1
+    p->boot_profile.num_events = 0;
+    p->boot_profile.lost_events = 0;
+    profile_enabled = (chip_cycle_counter_start(true) == 0);
+#else
+    /* an earlier stage built without profiling leaves garbage behind */
+    if (p->boot_profile.num_events > BOOT_PROFILE_MAX_EVENTS) {
+        p->boot_profile.num_events = 0;
+        p->boot_profile.lost_events = 0;
+    }
+    profile_enabled = (chip_cycle_counter_start(false) == 0);
+#endif
+
+    boot_profile_mark(BOOT_PHASE_ENTRY, 0);
+}
+
+void boot_profile_mark(boot_phase phase, uint16_t arg) {
+    communication_area *p = (communication_area *)&_communication_area;
+    boot_profile_event *event;
+    uint32_t cycles;
+
+    if (!profile_enabled) {
+        return;
+    }
+
+    cycles = chip_cycle_counter_read();
+
+    if (p->boot_profile.num_events >= BOOT_PROFILE_MAX_EVENTS) {
+        p->boot_profile.lost_events++;
+        return;
+    }
+
+    event = &p->boot_profile.events[p->boot_profile.num_events++];
+    event->cycles = cycles;
+    event->stage = BOOT_STAGE;
+    event->phase = phase;
+    event->arg = arg;
+}
+
+#endif /* _BOOT_PROFILE */
@@ -38,11 +38,25 @@
 
 void (*sha256_init_func)(sha256 *sh);
 void (*sha256_process_func)(sha256 *sh,int byte);
+void (*sha256_process_block_func)(sha256 *sh,const char *data,unsigned int len);
 void (*sha256_hash_func)(sha256 *sh,char hash[32]);
 int (*rsa2048_verify_func)(char digest[], char signature[], char public_key[]);
+int (*rsa2048_verify_mont_func)(char digest[], BIG n[], BIG n0, BIG r2[],
+                                char signature[]);
+#ifdef MONTGOMERY
+void (*rsa2048_pow_start_func)(rsa_pow_job *j, BIG n[], BIG n0, BIG r2[],
+                               char signature[]);
+int (*rsa2048_pow_step_func)(rsa_pow_job *j);
+int (*rsa2048_pow_check_func)(char digest[], rsa_pow_job *j);
+#endif
 
 #ifndef _NOCRYPTO
 static sha256 shctx;
+#ifdef MONTGOMERY
+/* The signature check started by verify_signature_start, if any */
+static rsa_pow_job pending_job;
+static tftf_signature *pending_signature;
+#endif
 #endif
 
 /**
@@ -70,6 +84,13 @@ void hash_start(void) {
 void hash_update(unsigned char *data, uint32_t datalen) {
 #ifndef _NOCRYPTO
     uint32_t i;
+
+    if (sha256_process_block_func != NULL) {
+        sha256_process_block_func(&shctx, (const char *)data, datalen);
+        return;
+    }
+
+    /* a boot ROM that only shares the byte-wise update */
     for (i = 0; i < datalen; i++) {
         sha256_process_func(&shctx, data[i]);
     }
@@ -91,7 +112,43 @@ void hash_final(unsigned char *digest) {
 }
 
 #if BOOT_STAGE == 1
-static int find_public_key(tftf_signature *signature, const unsigned char **key) {
+/**
+ * @brief Check that precomputed Montgomery constants belong to a public key
+ *
+ * The constants are only ever used as a short-cut, so a table that is out of
+ * step with the keys makes us fall back to the full verification rather than
+ * verify against the wrong modulus.
+ *
+ * @param key The public key (big-endian modulus)
+ * @param mont The precomputed constants, or NULL
+ *
+ * @returns mont if it matches the key, NULL otherwise
+ */
+static const crypto_public_key_mont *
+check_key_mont(const unsigned char *key, const crypto_public_key_mont *mont) {
+    const unsigned char *p;
+    uint32_t i;
+
+    if (mont == NULL || mont->n0 == 0) {
+        return NULL;
+    }
+
+    for (i = 0; i < RSA2048_PUBLIC_KEY_WORDS; i++) {
+        p = &key[RSA2048_PUBLIC_KEY_SIZE - sizeof(uint32_t) * (i + 1)];
+        if (mont->modulus[i] != (((uint32_t)p[0] << 24) |
+                                 ((uint32_t)p[1] << 16) |
+                                 ((uint32_t)p[2] << 8) |
+                                 (uint32_t)p[3])) {
+            return NULL;
+        }
+    }
+
+    return mont;
+}
+
+static int find_public_key(tftf_signature *signature,
+                           const unsigned char **key,
+                           const crypto_public_key_mont **mont) {
     uint32_t k;
 
     for (k = 0; k < number_of_public_keys; k++) {
@@ -109,6 +166,10 @@ static int find_public_key(tftf_signature *signature, const unsigned char **key)
                      sizeof(public_keys[k].key_name))) {
             dbgprint("Found pub. key\n");
             *key = public_keys[k].key;
+            *mont = NULL;
+            if (k < number_of_public_keys_mont) {
+                *mont = check_key_mont(*key, &public_keys_mont[k]);
+            }
             return 0;
         }
     }
@@ -117,7 +178,9 @@ static int find_public_key(tftf_signature *signature, const unsigned char **key)
     return -1;
 }
 #else
-static int find_public_key(tftf_signature *signature, const unsigned char **key) {
+static int find_public_key(tftf_signature *signature,
+                           const unsigned char **key,
+                           const crypto_public_key_mont **mont) {
     secondstage_cfgdata *cfgdata;
     uint32_t k;
 
@@ -132,6 +195,8 @@ static int find_public_key(tftf_signature *signature, const unsigned char **key)
                         sizeof(cfgdata->public_keys[k].key_name))) {
                 dbgprint("Found pub. key\n");
                 *key = cfgdata->public_keys[k].key;
+                /* (no precomputed constants for config data keys) */
+                *mont = NULL;
                 return 0;
             }
         }
@@ -142,6 +207,35 @@ static int find_public_key(tftf_signature *signature, const unsigned char **key)
 }
 #endif
 
+/**
+ * @brief Report the outcome of a signature check
+ *
+ * @param ret The result of the check, 0 if the digest verified
+ * @param digest The SHA digest obtained from hash-final.
+ * @param signature A pointer to the TFTF signature block.
+ *
+ * @returns ret
+ */
+static int signature_result(int ret, unsigned char *digest,
+                            tftf_signature *signature) {
+    if (ret) {
+        dbgprint("Signature failed\n");
+    } else {
+        dbgprint("Signature verified\n");
+#if BOOT_STAGE == 1
+        communication_area *p = (communication_area *)&_communication_area;
+        memcpy(p->stage_2_firmware_identity,
+               digest,
+               sizeof(p->stage_2_firmware_identity));
+        memcpy(p->stage_2_validation_key_name,
+               signature->key_name,
+               sizeof(p->stage_2_validation_key_name));
+#endif
+    }
+
+    return ret;
+}
+
 /**
  * @brief Verify a SHA digest against a signature
  *
@@ -162,42 +256,148 @@ int verify_signature(unsigned char *digest, tftf_signature *signature) {
 #endif
     int ret;
     const unsigned char *public_key;
+    const crypto_public_key_mont *mont;
 
-    if (find_public_key(signature, &public_key)) {
+    if (find_public_key(signature, &public_key, &mont)) {
         return -1;
     }
 
-    ret = rsa2048_verify_func((char *)digest,
-                              (char *)public_key,
-                              (char *)signature->signature) ? 0 : -1;
-
-    if (ret) {
-        dbgprint("Signature failed\n");
+    if (mont != NULL && rsa2048_verify_mont_func != NULL) {
+        ret = rsa2048_verify_mont_func((char *)digest,
+                                       (BIG *)mont->modulus,
+                                       mont->n0,
+                                       (BIG *)mont->r2,
+                                       (char *)signature->signature) ? 0 : -1;
     } else {
-        dbgprint("Signature verified\n");
-#if BOOT_STAGE == 1
-        communication_area *p = (communication_area *)&_communication_area;
-        memcpy(p->stage_2_firmware_identity,
-               digest,
-               sizeof(p->stage_2_firmware_identity));
-        memcpy(p->stage_2_validation_key_name,
-               signature->key_name,
-               sizeof(p->stage_2_validation_key_name));
+        ret = rsa2048_verify_func((char *)digest,
+                                  (char *)public_key,
+                                  (char *)signature->signature) ? 0 : -1;
+    }
+
+    return signature_result(ret, digest, signature);
+}
+
+/**
+ * @brief Start checking a signature before the digest is known
+ *
+ * The expensive part of an RSA verification only depends on the signature
+ * and the key, so it can be done in slices (see verify_signature_step) while
+ * the data being signed is still being loaded.
+ *
+ * @param signature A pointer to the TFTF signature block. It must stay put
+ *        until verify_signature_finish is called.
+ *
+ * @returns 0 if the check was started, -1 if the signature can only be
+ *          checked by verify_signature
+ */
+int verify_signature_start(tftf_signature *signature) {
+#if defined(_NOCRYPTO) || !defined(MONTGOMERY)
+    return -1;
+#else
+    const unsigned char *public_key;
+    const crypto_public_key_mont *mont;
+
+    pending_signature = NULL;
+    /* (a pending check is stepped and completed with the other two) */
+    if (rsa2048_pow_start_func == NULL ||
+        rsa2048_pow_step_func == NULL ||
+        rsa2048_pow_check_func == NULL ||
+        find_public_key(signature, &public_key, &mont) ||
+        mont == NULL) {
+        return -1;
+    }
+
+    rsa2048_pow_start_func(&pending_job,
+                           (BIG *)mont->modulus,
+                           mont->n0,
+                           (BIG *)mont->r2,
+                           (char *)signature->signature);
+    pending_signature = signature;
+    return 0;
 #endif
+}
+
+/**
+ * @brief Do one slice of the signature check started by verify_signature_start
+ *
+ * Meant to be called from wherever the loaders wait for data. It does
+ * nothing if no check is pending or the pending one is complete.
+ *
+ * @param none
+ *
+ * @returns Nothing
+ */
+void verify_signature_step(void) {
+#if !defined(_NOCRYPTO) && defined(MONTGOMERY)
+    if (pending_signature != NULL) {
+        rsa2048_pow_step_func(&pending_job);
     }
+#endif
+}
 
-    return ret;
+/**
+ * @brief Verify a SHA digest against a signature
+ *
+ * Completes the check started by verify_signature_start for this signature,
+ * or falls back to verify_signature if there is none.
+ *
+ * @param digest The SHA digest obtained from hash-final.
+ * @param signature A pointer to the TFTF signature block.
+ *
+ * @returns 0 if the digest verifies, non-zero otherwise
+ */
+int verify_signature_finish(unsigned char *digest,
+                            tftf_signature *signature) {
+#if !defined(_NOCRYPTO) && defined(MONTGOMERY)
+    int ret;
+
+    if (pending_signature != NULL && pending_signature == signature) {
+        pending_signature = NULL;
+        ret = rsa2048_pow_check_func((char *)digest, &pending_job) ? 0 : -1;
+        return signature_result(ret, digest, signature);
+    }
+#endif
+    return verify_signature(digest, signature);
 }
 
 void crypto_init(void) {
-#if BOOT_STAGE == 1
+/*
+ * A hostsim stage is a program of its own, with no boot ROM code around to
+ * point the shared functions at, so it shares its own copies.
+ */
+#if BOOT_STAGE == 1 || defined(CONFIG_HOSTSIM)
     set_shared_function(SHARED_FUNCTION_SHA256_INIT, shs256_init);
     set_shared_function(SHARED_FUNCTION_SHA256_PROCESS, shs256_process);
     set_shared_function(SHARED_FUNCTION_SHA256_HASH, shs256_hash);
     set_shared_function(SHARED_FUNCTION_RSA2048_VERIFY, rsa_verify);
+    init_shared_functions_ext();
+    set_shared_function_ext(SHARED_FUNCTION_EXT_SHA256_PROCESS_BLOCK,
+                            shs256_process_block);
+#ifdef MONTGOMERY
+    set_shared_function_ext(SHARED_FUNCTION_EXT_RSA2048_VERIFY_MONT,
+                            rsa_verify_mont);
+    set_shared_function_ext(SHARED_FUNCTION_EXT_RSA2048_POW_START,
+                            rsa_pow_start);
+    set_shared_function_ext(SHARED_FUNCTION_EXT_RSA2048_POW_STEP,
+                            rsa_pow_step);
+    set_shared_function_ext(SHARED_FUNCTION_EXT_RSA2048_POW_CHECK,
+                            rsa_pow_check);
+#endif
 #endif
     sha256_init_func = get_shared_function(SHARED_FUNCTION_SHA256_INIT);
     sha256_process_func = get_shared_function(SHARED_FUNCTION_SHA256_PROCESS);
+    sha256_process_block_func =
+        get_shared_function_ext(SHARED_FUNCTION_EXT_SHA256_PROCESS_BLOCK);
     sha256_hash_func = get_shared_function(SHARED_FUNCTION_SHA256_HASH);
     rsa2048_verify_func = get_shared_function(SHARED_FUNCTION_RSA2048_VERIFY);
+    rsa2048_verify_mont_func =
+        get_shared_function_ext(SHARED_FUNCTION_EXT_RSA2048_VERIFY_MONT);
+#ifdef MONTGOMERY
+    rsa2048_pow_start_func =
+        get_shared_function_ext(SHARED_FUNCTION_EXT_RSA2048_POW_START);
+    rsa2048_pow_step_func =
+        get_shared_function_ext(SHARED_FUNCTION_EXT_RSA2048_POW_STEP);
+    rsa2048_pow_check_func =
+        get_shared_function_ext(SHARED_FUNCTION_EXT_RSA2048_POW_CHECK);
+#endif
 }
@@ -35,16 +35,150 @@
 #include "debug.h"
 #include "data_loading.h"
 #include "error.h"
+#include "crypto.h"
+#include "communication_area.h"
 
 typedef struct {
-    ffff_header header1;
-    ffff_header header2;
+    ffff_header header;
     ffff_header *cur_header;
+    uint32_t cur_header_address;
     ffff_element_descriptor *cur_element;
+    /* the element index of the hand-off, if the header came from there */
+    ffff_handoff_data *handoff;
 } ffff_processing_state;
 
 static ffff_processing_state ffff;
 
+/* An index of the elements of the largest header supported */
+typedef uint16_t ffff_element_index;
+typedef char ___ffff_element_index_test[
+        (CALC_MAX_FFFF_ELEMENTS(MAX_FFFF_HEADER_SIZE_SUPPORTED) <=
+         (1 << (8 * sizeof(ffff_element_index)))) ? 1 : -1];
+
+typedef bool (*ffff_element_before)(ffff_element_descriptor *a,
+                                    ffff_element_descriptor *b);
+
+static bool element_location_before(ffff_element_descriptor *a,
+                                    ffff_element_descriptor *b) {
+    return a->element_location < b->element_location;
+}
+
+static bool element_identity_before(ffff_element_descriptor *a,
+                                    ffff_element_descriptor *b) {
+    if (a->element_type != b->element_type) {
+        return a->element_type < b->element_type;
+    }
+    if (a->element_id != b->element_id) {
+        return a->element_id < b->element_id;
+    }
+    return a->element_generation < b->element_generation;
+}
+
+/**
+ * @brief Sort an index of FFFF elements (heapsort: in place, no recursion)
+ *
+ * @param elements The elements the index refers to
+ * @param index The index to sort
+ * @param count The number of entries in the index
+ * @param before The order to sort in
+ *
+ * @returns Nothing
+ */
+static void sort_ffff_elements(ffff_element_descriptor *elements,
+                               ffff_element_index *index,
+                               uint32_t count,
+                               ffff_element_before before) {
+    ffff_element_index tmp;
+    uint32_t start = count / 2;
+    uint32_t end = count;
+    uint32_t root;
+    uint32_t child;
+
+    while (end > 1) {
+        if (start > 0) {
+            /* building the heap */
+            start--;
+        } else {
+            /* moving the largest one out of the heap */
+            end--;
+            tmp = index[0];
+            index[0] = index[end];
+            index[end] = tmp;
+        }
+
+        root = start;
+        while ((child = 2 * root + 1) < end) {
+            if (child + 1 < end &&
+                before(&elements[index[child]], &elements[index[child + 1]])) {
+                child++;
+            }
+            if (!before(&elements[index[root]], &elements[index[child]])) {
+                break;
+            }
+            tmp = index[root];
+            index[root] = index[child];
+            index[child] = tmp;
+            root = child;
+        }
+    }
+}
+
+/**
+ * @brief Check whether any two FFFF elements may collide or be duplicates
+ *
+ * Sorting the elements by location and by type/id/generation leaves only
+ * neighbours to compare, instead of every pair. This only tells whether
+ * there is a problem: it is up to valid_ffff_element to tell which one, and
+ * it is only asked to if there is one. Elements without a proper extent
+ * (empty, or wrapping around) are left to valid_ffff_element too.
+ *
+ * @param elements The element table
+ * @param count The number of elements in the table, up to (not including)
+ *        the FFFF_ELEMENT_END marker
+ *
+ * @returns False if no two elements collide or are duplicates, true if some
+ *          may
+ */
+static bool ffff_elements_may_conflict(ffff_element_descriptor *elements,
+                                       uint32_t count) {
+    ffff_element_index index[
+            CALC_MAX_FFFF_ELEMENTS(MAX_FFFF_HEADER_SIZE_SUPPORTED)];
+    ffff_element_descriptor *element;
+    ffff_element_descriptor *previous;
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        if (elements[i].element_length == 0 ||
+            elements[i].element_location + (elements[i].element_length - 1) <
+            elements[i].element_location) {
+            return true;
+        }
+        index[i] = i;
+    }
+
+    /* (a) collisions: each element must start after the previous one ends */
+    sort_ffff_elements(elements, index, count, element_location_before);
+    for (i = 1; i < count; i++) {
+        previous = &elements[index[i - 1]];
+        element = &elements[index[i]];
+        if (element->element_location <=
+            previous->element_location + previous->element_length - 1) {
+            return true;
+        }
+    }
+
+    /* (b) duplicates: no two neighbours may have the same identity */
+    sort_ffff_elements(elements, index, count, element_identity_before);
+    for (i = 1; i < count; i++) {
+        if (!element_identity_before(&elements[index[i - 1]],
+                                     &elements[index[i]])) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 /**
  * @brief Validate an FFFF element
  *
@@ -52,12 +186,16 @@ static ffff_processing_state ffff;
  * @param header (The RAM-address of) the FFFF header to which it belongs
  * @param end_of_elements Pointer to a flag that will be set if the element
  *        type is the FFFF_ELEMENT_END marker. (Untouched if not)
+ * @param check_others Whether to check the element against the following
+ *        ones for collisions and duplicates (there is no need to if
+ *        ffff_elements_may_conflict found none)
  *
  * @returns True if valid element, false otherwise
  */
 bool valid_ffff_element(ffff_element_descriptor * element,
                         ffff_header * header,
-                        bool *end_of_elements) {
+                        bool *end_of_elements,
+                        bool check_others) {
     ffff_element_descriptor * other_element;
     uint32_t element_location_min;
     uint32_t element_location_max = header->flash_image_length;
@@ -109,7 +247,8 @@ bool valid_ffff_element(ffff_element_descriptor * element,
      * they don't duplicate or collide with us.
      */
     for (other_element = element + 1;
-         (!is_element_out_of_range(header, other_element) &&
+         (check_others &&
+          !is_element_out_of_range(header, other_element) &&
           (other_element->element_type != FFFF_ELEMENT_END));
          other_element++) {
         /* (a) check for collision */
@@ -142,6 +281,8 @@ bool valid_ffff_element(ffff_element_descriptor * element,
 
 static int validate_ffff_header(ffff_header *header) {
     ffff_element_descriptor * element;
+    uint32_t number_of_elements = 0;
+    bool check_others;
     bool end_of_elements = false;
     char *trailing_sentinel_value;
 
@@ -171,10 +312,19 @@ static int validate_ffff_header(ffff_header *header) {
     }
 
     /* Validate the FFFF elements */
+    for (element = &header->elements[0];
+         !is_element_out_of_range(header, element) &&
+         element->element_type != FFFF_ELEMENT_END;
+         element++) {
+        number_of_elements++;
+    }
+    check_others = ffff_elements_may_conflict(&header->elements[0],
+                                              number_of_elements);
     for (element = &header->elements[0];
          !is_element_out_of_range(header, element) && !end_of_elements;
          element++) {
-        if (!valid_ffff_element(element, header, &end_of_elements)) {
+        if (!valid_ffff_element(element, header, &end_of_elements,
+                                check_others)) {
             /* (valid_ffff_element took care of error reporting) */
             return -1;
         }
@@ -188,25 +338,36 @@ static int validate_ffff_header(ffff_header *header) {
     return 0;
 }
 
+/*
+ * The leading part of a header: enough to tell whether there is one, how
+ * large it is and which generation it is
+ */
+#define FFFF_PROBE_SIZE \
+    (offsetof(ffff_header, header_generation) + sizeof(uint32_t))
+
 /**
- * @brief try to load FFFF header from ROM at addr
+ * @brief Read the leading part of an FFFF header
+ *
+ * The leading sentinel is read alone first: most of the addresses probed
+ * when looking for the second header hold no header at all, and those cost a
+ * sentinel's worth of reading instead of a whole minimum-size header.
+ *
  * @param ops data loading operation structure
- * @param buf buffer to store the header
- * @param addr address on storage media to load the header
- * @param valid_header indicates whether the header at the specified addr
- *                     is valid FFFF header or not.
+ * @param buf buffer to store the leading FFFF_PROBE_SIZE bytes of the header
+ * @param addr address on storage media to read the header from
+ * @param found indicates whether there looks to be a header at addr
  * @return -1 for fatal error, the whole operation should fail
- *          0 for able to load something, *valid_header indicates if
- *            it is a valid FFFF header
+ *          0 for able to read something, *found indicates if the sentinel
+ *            and header size are those of an FFFF header
  */
-static int load_ffff_header(data_load_ops *ops,
-                            unsigned char *buf,
-                            uint32_t addr,
-                            bool *valid_header) {
+static int probe_ffff_header(data_load_ops *ops,
+                             unsigned char *buf,
+                             uint32_t addr,
+                             bool *found) {
     ffff_header *header = (ffff_header *)buf;
-    *valid_header = false;
+    *found = false;
 
-    if (ops->read(buf, addr, FFFF_HEADER_SIZE_MIN)) {
+    if (ops->read(buf, addr, FFFF_SENTINEL_SIZE)) {
         set_last_error(BRE_FFFF_LOAD_HEADER);
         return -1;
     }
@@ -219,19 +380,50 @@ static int load_ffff_header(data_load_ops *ops,
         return 0;
     }
 
+    if (ops->read(&buf[FFFF_SENTINEL_SIZE],
+                  addr + FFFF_SENTINEL_SIZE,
+                  FFFF_PROBE_SIZE - FFFF_SENTINEL_SIZE)) {
+        set_last_error(BRE_FFFF_LOAD_HEADER);
+        return -1;
+    }
+
     if (header->header_size < FFFF_HEADER_SIZE_MIN ||
         header->header_size > MAX_FFFF_HEADER_SIZE_SUPPORTED) {
         set_last_error(BRE_FFFF_HEADER_SIZE);
        return 0;
     }
 
-    if (header->header_size != FFFF_HEADER_SIZE_MIN) {
-        if (ops->read(&buf[FFFF_HEADER_SIZE_MIN],
-                      addr + FFFF_HEADER_SIZE_MIN,
-                      header->header_size - FFFF_HEADER_SIZE_MIN)) {
-            set_last_error(BRE_FFFF_LOAD_HEADER);
-            return -1;
-        }
+    *found = true;
+    return 0;
+}
+
+/**
+ * @brief Read the rest of an FFFF header found by probe_ffff_header and
+ *        validate it
+ *
+ * @param ops data loading operation structure
+ * @param buf buffer holding the leading part of the header, to store the
+ *            header in
+ * @param addr address on storage media of the header
+ * @param valid_header indicates whether the header at the specified addr
+ *                     is valid FFFF header or not.
+ * @return -1 for fatal error, the whole operation should fail
+ *          0 for able to load something, *valid_header indicates if
+ *            it is a valid FFFF header
+ */
+static int finish_ffff_header(data_load_ops *ops,
+                              unsigned char *buf,
+                              uint32_t addr,
+                              bool *valid_header) {
+    ffff_header *header = (ffff_header *)buf;
+    *valid_header = false;
+
+    /* the rest of the header, in one transfer */
+    if (ops->read(&buf[FFFF_PROBE_SIZE],
+                  addr + FFFF_PROBE_SIZE,
+                  header->header_size - FFFF_PROBE_SIZE)) {
+        set_last_error(BRE_FFFF_LOAD_HEADER);
+        return -1;
     }
 
     if (!validate_ffff_header(header)) {
@@ -241,16 +433,49 @@ static int load_ffff_header(data_load_ops *ops,
     return 0;
 }
 
+/**
+ * @brief try to load FFFF header from ROM at addr
+ * @param ops data loading operation structure
+ * @param buf buffer to store the header
+ * @param addr address on storage media to load the header
+ * @param valid_header indicates whether the header at the specified addr
+ *                     is valid FFFF header or not.
+ * @return -1 for fatal error, the whole operation should fail
+ *          0 for able to load something, *valid_header indicates if
+ *            it is a valid FFFF header
+ */
+static int load_ffff_header(data_load_ops *ops,
+                            unsigned char *buf,
+                            uint32_t addr,
+                            bool *valid_header) {
+    bool found;
+
+    *valid_header = false;
+
+    if (probe_ffff_header(ops, buf, addr, &found)) {
+        return -1;
+    } else if (!found) {
+        /* (probe_ffff_header took care of error reporting) */
+        return 0;
+    }
+
+    return finish_ffff_header(ops, buf, addr, valid_header);
+}
+
 static int locate_ffff_table(data_load_ops *ops)
 {
     uint32_t address = 0;
     bool valid_header;
+    bool found;
+    /* only the leading part of the second header, see probe_ffff_header */
+    uint32_t second_buf[FFFF_PROBE_SIZE / sizeof(uint32_t)];
+    ffff_header *second = (ffff_header *)second_buf;
 
-    ffff.cur_header = &ffff.header1;
+    ffff.cur_header = &ffff.header;
 
     /**
-     * This function sets ffff.cur_header to point to the static buffer
-     * containing the newest FFFF header structure in the FFFF storage.
+     * This function loads the newest FFFF header structure in the FFFF
+     * storage into the static buffer ffff.cur_header points to.
      * Each FFFF storage normally has two identical (and consecutive) copies
      * of the FFFF header at the beginning of the storage, but those can
      * become damaged or out of sync if an update operation is interrupted.
@@ -258,13 +483,17 @@ static int locate_ffff_table(data_load_ops *ops)
      * If it finds the first header, that tells it where the second header
      * will be; otherwise, it searches on power-of-two boundaries to locate
      * a second header. It is an error (failure) if no valid headers can be
-     * found. If only one is found, it is used as ffff.cur_header. If two are
-     * found, the newest one (based on header_generation) is used as
-     * ffff.cur_header.
+     * found. If only one is found, it is used. If two are found, the newest
+     * one (based on header_generation) is used.
+     *
+     * There is room for one header only: the leading part of the second
+     * one is read on its own, and the rest of it is only read (over the
+     * first one) if it is newer. If it then turns out not to be valid, the
+     * first one is loaded again.
      **/
 
     /* First look for header at beginning of the storage */
-    if (load_ffff_header(ops, ffff.header1.buffer, address, &valid_header)) {
+    if (load_ffff_header(ops, ffff.header.buffer, address, &valid_header)) {
         return -1;
     } else if (!valid_header) {
         /* There is no valid FFFF table at address 0, this means the first
@@ -272,12 +501,12 @@ static int locate_ffff_table(data_load_ops *ops)
         address = FFFF_HEADER_SIZE_MIN;
         while(address < FFFF_ERASE_BLOCK_SIZE_MAX * 2) {
             if (load_ffff_header(ops,
-                                 ffff.header2.buffer,
+                                 ffff.header.buffer,
                                  address,
                                  &valid_header)) {
                 return -1;
             } else if(valid_header) {
-                ffff.cur_header = &ffff.header2;
+                ffff.cur_header_address = address;
                 reset_last_error();
                 return 0;
             }
@@ -288,55 +517,248 @@ static int locate_ffff_table(data_load_ops *ops)
     }
 
     /* A valid FFFF table is at address 0, now look for the second one */
-    address = ffff.header1.erase_block_size;
-    if (address < ffff.header1.header_size) {
-        address = ffff.header1.header_size;
+    address = ffff.header.erase_block_size;
+    if (address < ffff.header.header_size) {
+        address = ffff.header.header_size;
     }
-    if (load_ffff_header(ops, ffff.header2.buffer, address, &valid_header)) {
+    if (probe_ffff_header(ops, (unsigned char *)second_buf, address,
+                          &found)) {
         return -1;
-    } else if(!valid_header) {
-        /* Did not find the second copy, so use the first one */
+    } else if (!found ||
+               second->header_generation <=
+               ffff.header.header_generation) {
+        /* No second copy, or not a newer one, so use the first one */
+        ffff.cur_header_address = 0;
         reset_last_error();
         return 0;
     }
 
-    if (ffff.header2.header_generation > ffff.header1.header_generation) {
-        ffff.cur_header = &ffff.header2;
+    /* The second copy is newer, it takes the place of the first one... */
+    memcpy(ffff.header.buffer, second_buf, FFFF_PROBE_SIZE);
+    ffff.cur_header_address = address;
+    if (finish_ffff_header(ops, ffff.header.buffer, address, &valid_header)) {
+        return -1;
+    } else if (!valid_header) {
+        /* ...unless it is damaged, then go back to the first one */
+        ffff.cur_header_address = 0;
+        if (load_ffff_header(ops, ffff.header.buffer, 0, &valid_header)) {
+            return -1;
+        } else if (!valid_header) {
+            /* (load_ffff_header took care of error reporting) */
+            return -1;
+        }
     }
     reset_last_error();
     return 0;
 }
 
-static int locate_element(data_load_ops *ops,
-                          uint32_t type,
-                          uint32_t *length) {
+/*
+ * The boot ROM hands the FFFF header it found over to the later stages. The
+ * gbboot server build serves its flash to other bridges: it has nothing to
+ * hand over, and no crypto set up to hash it with.
+ */
+#if BOOT_STAGE != 1
+#define FFFF_HANDOFF_TAKE
+#elif !defined(BUILD_FOR_GBBOOT_SERVER)
+#define FFFF_HANDOFF_PUBLISH
+#endif
+
+#if defined(FFFF_HANDOFF_PUBLISH) || defined(FFFF_HANDOFF_TAKE)
+/* the hand-off digest is the one hash_final gives */
+typedef char ___ffff_handoff_digest_test[
+        (FFFF_HANDOFF_DIGEST_SIZE == SHA256_HASH_DIGEST_SIZE) ? 1 : -1];
+
+static void ffff_header_digest(ffff_header *header, unsigned char *digest) {
+    hash_start();
+    hash_update(header->buffer, header->header_size);
+    hash_final(digest);
+}
+#endif
+
+#ifdef FFFF_HANDOFF_PUBLISH
+/**
+ * @brief Leave the FFFF header found by locate_ffff_table to the next stage
+ *
+ * @param handoff The hand-off record in the communication area
+ *
+ * @returns Nothing
+ */
+static void publish_ffff_handoff(ffff_handoff_data *handoff) {
+    ffff_element_descriptor *element;
+    uint32_t count = 0;
+
+    handoff->header_address = ffff.cur_header_address;
+    handoff->header_size = ffff.cur_header->header_size;
+    handoff->header_generation = ffff.cur_header->header_generation;
+    ffff_header_digest(ffff.cur_header, handoff->header_digest);
+
+    for (element = &ffff.cur_header->elements[0];
+         !is_element_out_of_range(ffff.cur_header, element) &&
+         element->element_type != FFFF_ELEMENT_END;
+         element++) {
+        if (count == FFFF_HANDOFF_MAX_ELEMENTS) {
+            count = FFFF_HANDOFF_NOT_INDEXED;
+            break;
+        }
+        handoff->elements[count].slot = element -
+                                        &ffff.cur_header->elements[0];
+        handoff->elements[count].type = element->element_type;
+        handoff->elements[count].reserved = 0;
+        handoff->elements[count].generation = element->element_generation;
+        count++;
+    }
+    handoff->number_of_elements = count;
+    handoff->reserved = 0;
+
+    handoff->magic = FFFF_HANDOFF_MAGIC;
+}
+#endif
+
+#ifdef FFFF_HANDOFF_TAKE
+/**
+ * @brief Take the FFFF header an earlier stage found, instead of searching
+ *
+ * The header is read from where the hand-off says it is, and used if it is
+ * the one the earlier stage found: validating it again would give the same
+ * result.
+ *
+ * @param ops data loading operation structure
+ * @param handoff The hand-off record in the communication area
+ *
+ * @returns 0 if the header is in ffff.cur_header, <0 if there is none to
+ *          take, or not the same as the earlier stage's
+ */
+static int take_ffff_handoff(data_load_ops *ops,
+                             ffff_handoff_data *handoff) {
+    unsigned char digest[SHA256_HASH_DIGEST_SIZE];
+
+    if (handoff->magic != FFFF_HANDOFF_MAGIC ||
+        handoff->header_size < FFFF_HEADER_SIZE_MIN ||
+        handoff->header_size > MAX_FFFF_HEADER_SIZE_SUPPORTED) {
+        return -1;
+    }
+
+    /* the header, in one transfer */
+    if (ops->read(ffff.header.buffer, handoff->header_address,
+                  handoff->header_size)) {
+        return -1;
+    }
+
+    ffff.cur_header = &ffff.header;
+    if (ffff.cur_header->header_size != handoff->header_size) {
+        return -1;
+    }
+    ffff_header_digest(ffff.cur_header, digest);
+    if (memcmp(digest, handoff->header_digest, sizeof(digest))) {
+        return -1;
+    }
+
+    ffff.cur_header_address = handoff->header_address;
+    return 0;
+}
+
+/**
+ * @brief Locate an element with the element index of the FFFF hand-off
+ *
+ * @param handoff The hand-off record the header in ffff.cur_header came from
+ * @param type The element type to look for
+ *
+ * @returns The newest element of that type, NULL if there is none
+ */
+static ffff_element_descriptor *locate_handoff_element(
+        ffff_handoff_data *handoff,
+        uint32_t type) {
+    ffff_element_descriptor *element = NULL;
+    ffff_handoff_element *entry;
+    uint32_t generation = 0;
+    uint32_t i;
+
+    for (i = 0; i < handoff->number_of_elements; i++) {
+        entry = &handoff->elements[i];
+        if (entry->type != type ||
+            entry->slot >=
+            CALC_MAX_FFFF_ELEMENTS(ffff.cur_header->header_size)) {
+            continue;
+        }
+        /* the index is not covered by the digest, the header is */
+        if (ffff.cur_header->elements[entry->slot].element_type != type ||
+            ffff.cur_header->elements[entry->slot].element_generation !=
+            entry->generation) {
+            continue;
+        }
+        if (element == NULL || generation < entry->generation) {
+            element = &ffff.cur_header->elements[entry->slot];
+            generation = entry->generation;
+        }
+    }
+    return element;
+}
+#endif
+
+/*
+ * The order in which the elements of a type are tried: newest generation
+ * first, and elements of the same generation in table order.
+ */
+static bool element_boot_order_before(ffff_element_descriptor *a,
+                                      ffff_element_descriptor *b) {
+    if (a->element_generation != b->element_generation) {
+        return a->element_generation > b->element_generation;
+    }
+    return a < b;
+}
+
+/**
+ * @brief Find the element of a type that comes next in boot order
+ *
+ * @param type The element type to look for
+ * @param after The element to continue from, NULL to start from the newest
+ *
+ * @returns The first element of that type after "after" in boot order, NULL
+ *          if there is none
+ */
+static ffff_element_descriptor *next_element_of_type(
+        uint32_t type,
+        ffff_element_descriptor *after) {
     uint32_t last_possible_element = (uint32_t)ffff.cur_header +
                                      ffff.cur_header->header_size -
                                      FFFF_SENTINEL_SIZE -
                                      sizeof(ffff_element_descriptor);
-
-    if (length != NULL) {
-        *length = 0;
-    }
-
     ffff_element_descriptor *element = &ffff.cur_header->elements[0];
-
-    ffff.cur_element = NULL;
+    ffff_element_descriptor *next = NULL;
 
     while ((uint32_t)element <= last_possible_element) {
         if (element->element_type == FFFF_ELEMENT_END) {
             break;
         }
 
-        if (element->element_type == type) {
-            if (ffff.cur_element == NULL ||
-                ffff.cur_element->element_generation <
-                element->element_generation) {
-                ffff.cur_element = element;
-            }
+        if (element->element_type == type &&
+            (after == NULL || element_boot_order_before(after, element)) &&
+            (next == NULL || element_boot_order_before(element, next))) {
+            next = element;
         }
         element++;
     }
+    return next;
+}
+
+static int locate_element(data_load_ops *ops,
+                          uint32_t type,
+                          uint32_t *length) {
+    if (length != NULL) {
+        *length = 0;
+    }
+
+#ifdef FFFF_HANDOFF_TAKE
+    if (ffff.handoff != NULL &&
+        ffff.handoff->number_of_elements != FFFF_HANDOFF_NOT_INDEXED) {
+        /* the index lists all the elements of the header */
+        ffff.cur_element = locate_handoff_element(ffff.handoff, type);
+    } else {
+        ffff.cur_element = next_element_of_type(type, NULL);
+    }
+#else
+    ffff.cur_element = next_element_of_type(type, NULL);
+#endif
 
     if (ffff.cur_element == NULL) {
         set_last_error(BRE_FFFF_NO_FIRMWARE);
@@ -352,15 +774,32 @@ static int locate_element(data_load_ops *ops,
 int locate_ffff_element_on_storage(data_load_ops *ops,
                                    uint32_t type,
                                    uint32_t *length) {
+#if defined(FFFF_HANDOFF_PUBLISH) || defined(FFFF_HANDOFF_TAKE)
+    communication_area *p = (communication_area *)&_communication_area;
+#endif
+
     if (ops->read == NULL) {
         set_last_error(BRE_FFFF_LOGIC_ERROR);
         return -1;
     }
 
-    if (locate_ffff_table(ops)) {
+    ffff.handoff = NULL;
+#ifdef FFFF_HANDOFF_PUBLISH
+    /* nothing to hand off unless the search below succeeds */
+    p->ffff_handoff.magic = 0;
+#endif
+#ifdef FFFF_HANDOFF_TAKE
+    if (take_ffff_handoff(ops, &p->ffff_handoff) == 0) {
+        ffff.handoff = &p->ffff_handoff;
+    }
+#endif
+    if (ffff.handoff == NULL && locate_ffff_table(ops)) {
         /* (locate_ffff_table took care of error reporting) */
         return -1;
     }
+#ifdef FFFF_HANDOFF_PUBLISH
+    publish_ffff_handoff(&p->ffff_handoff);
+#endif
 
     if (locate_element(ops, type, length)) {
         /* (locate_next_stage_firmware took care of error reporting) */
@@ -372,3 +811,57 @@ int locate_ffff_element_on_storage(data_load_ops *ops,
     ops->read(NULL, ffff.cur_element->element_location, 0);
     return 0;
 }
+
+/**
+ * @brief Locate the next older copy of the element last located
+ *
+ * Moves on from the element found by locate_ffff_element_on_storage (or by
+ * the last call to this function) to the next one of the same type, newest
+ * first, e.g. to the other copy of an A/B update when the newer one does not
+ * load. The FFFF header is not located or validated again.
+ *
+ * @param ops data loading operation structure
+ * @param length pointer to where to return the length of the element
+ *
+ * @returns 0 on success, <0 if there is no older element
+ */
+int locate_next_ffff_element(data_load_ops *ops, uint32_t *length) {
+    ffff_element_descriptor *element;
+
+    if (ops->read == NULL || ffff.cur_element == NULL) {
+        set_last_error(BRE_FFFF_NO_FIRMWARE);
+        return -1;
+    }
+
+    element = next_element_of_type(ffff.cur_element->element_type,
+                                   ffff.cur_element);
+    if (element == NULL) {
+        set_last_error(BRE_FFFF_NO_FIRMWARE);
+        return -1;
+    }
+    ffff.cur_element = element;
+
+    if (length != NULL) {
+        *length = element->element_length;
+    }
+    ops->read(NULL, element->element_location, 0);
+    return 0;
+}
+
+/**
+ * @brief Get the storage address of the element found by the last call to
+ *        locate_ffff_element_on_storage
+ *
+ * @param location Where to return the address of the element on storage
+ *
+ * @returns 0 on success, <0 if no element has been located
+ */
+int get_ffff_element_location(uint32_t *location) {
+    if (ffff.cur_element == NULL) {
+        set_last_error(BRE_FFFF_NO_FIRMWARE);
+        return -1;
+    }
+
+    *location = ffff.cur_element->element_location;
+    return 0;
+}
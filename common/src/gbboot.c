@@ -40,9 +40,10 @@
 #include "greybus.h"
 #include "data_loading.h"
 #include "gbboot.h"
-#include "crypto.h"
+#include "tftf_crypto.h"
 
-#if (GB_MAX_PAYLOAD_SIZE > CPORT_RX_BUF_SIZE)
+#if (GB_MAX_PAYLOAD_SIZE > CPORT_RX_BUF_SIZE) || \
+    (GB_LARGE_PAYLOAD_SIZE > CPORT_RX_BUF_SIZE)
     #error "Greybus maximal payload must be smaller than CPort RX buffer"
 #endif
 
@@ -51,9 +52,6 @@ static uint32_t gbboot_cportid = GBBOOT_CPORT;
 /* We are receiving a firmware package in TFTF format, and not a raw firmware
  * binary
  */
-/* Greybus FirmWare protocol version we support */
-#define GB_FIRMWARE_VERSION_MAJOR   0x00
-#define GB_FIRMWARE_VERSION_MINOR   0x01
 
 #define CPORT_POLLING_TIMEOUT       512
 
@@ -61,8 +59,26 @@ static uint8_t responded_op = GB_BOOT_OP_INVALID;
 
 int fw_cport_handler(uint32_t cportid, void *data, size_t len);
 
+/* Largest chunk a single GET_FIRMWARE request may ask the server for */
+static uint32_t gbboot_chunk_size = GB_MAX_PAYLOAD_SIZE;
+
 static int gbboot_get_version(uint32_t cportid, gb_operation_header *header) {
-    uint8_t payload[2] = {GB_FIRMWARE_VERSION_MAJOR, GB_FIRMWARE_VERSION_MINOR};
+    struct gbboot_protocol_version_request *req =
+        (struct gbboot_protocol_version_request *)(header + 1);
+    uint8_t payload[2] = {GB_BOOT_VERSION_MAJOR, GB_BOOT_VERSION_MINOR};
+
+    /**
+     * The server announces its own version in the request. Only a server
+     * that knows about large chunks gets asked for them, anything older
+     * (or a request without a version) keeps the original chunk size.
+     */
+    gbboot_chunk_size = GB_MAX_PAYLOAD_SIZE;
+    if (gb_operation_request_size(header) >= (int)sizeof(*req) &&
+        req->major == GB_BOOT_VERSION_LARGE_MAJOR &&
+        req->minor >= GB_BOOT_VERSION_LARGE_MINOR) {
+        gbboot_chunk_size = GB_LARGE_PAYLOAD_SIZE;
+    }
+
     return greybus_op_response(cportid, header, GB_OP_SUCCESS, payload,
                                sizeof(payload));
 }
@@ -119,38 +135,65 @@ static int gbboot_firmware_size_response(gb_operation_header *head, void *data,
     return 1;
 }
 
+/*
+ * Number of GET_FIRMWARE requests kept in flight by a load. The server can
+ * then read the next chunks while earlier ones are on the link or being
+ * hashed, so a load is no longer paced by one round trip per chunk.
+ */
+#ifndef GB_GET_FIRMWARE_WINDOW
+#define GB_GET_FIRMWARE_WINDOW      4
+#endif
+
+#if (GB_GET_FIRMWARE_WINDOW < 1)
+    #error "GB_GET_FIRMWARE_WINDOW must be at least 1"
+#endif
+
+/*
+ * One entry per request in flight. The operation ID of a request is its slot
+ * number + 1 (0 is reserved for unidirectional operations), so the response
+ * handler can copy the data straight to where it belongs. "buffer" is NULL
+ * once the slot has been answered.
+ */
 static struct fw_get_firmware_buff {
     uint8_t *buffer;
     uint32_t size;
-} fw_get_firmware_buff;
+#ifdef _UNIPRO_RX_PLACEMENT
+    bool placed; /* payload was received in place by gbboot_place_rx() */
+#endif
+} fw_get_firmware_buff[GB_GET_FIRMWARE_WINDOW];
 
-static int gbboot_get_firmware(uint32_t offset, uint32_t size, void *data,
-                             void* prev, uint32_t prev_len) {
-    int rc;
+static int gbboot_get_firmware_send(uint32_t slot, uint32_t offset,
+                                    uint32_t size, void *data) {
     struct gbboot_get_firmware_request req = {offset, size};
-    rc = greybus_send_request(gbboot_cportid, 1, GB_BOOT_OP_GET_FIRMWARE,
-                              (uint8_t*)&req, sizeof(req));
-    if (rc) {
-        return rc;
-    }
 
-    /* prev_len is set only when hash is required */
-    if (prev_len > 0) {
-        hash_update((unsigned char*)prev, prev_len);
-    }
+    fw_get_firmware_buff[slot].buffer = data;
+    fw_get_firmware_buff[slot].size   = size;
+#ifdef _UNIPRO_RX_PLACEMENT
+    fw_get_firmware_buff[slot].placed = false;
+#endif
 
-    fw_get_firmware_buff.buffer = data;
-    fw_get_firmware_buff.size   = size;
+    return greybus_send_request(gbboot_cportid, slot + 1,
+                                GB_BOOT_OP_GET_FIRMWARE,
+                                (uint8_t*)&req, sizeof(req));
+}
 
-    /* following loop breaks out after getting the firmware_response */
-    rc = greybus_loop();
-    if (rc) {
-        dbgprintx32("FW receive failed: -", -rc, "\n");
-        return rc;
-    }
-    if (responded_op != (GB_BOOT_OP_GET_FIRMWARE | GB_TYPE_RESPONSE)) {
-        dbgprint("Response wasn't get-FW\n");
-        return -ENODEV;
+static int gbboot_get_firmware_wait(uint32_t slot) {
+    int rc;
+
+    while (fw_get_firmware_buff[slot].buffer != NULL) {
+        /* put the wait to use on a signature check started ahead of time */
+        verify_signature_step();
+
+        /* following loop breaks out after getting a firmware_response */
+        rc = greybus_loop();
+        if (rc) {
+            dbgprintx32("FW receive failed: -", -rc, "\n");
+            return rc;
+        }
+        if (responded_op != (GB_BOOT_OP_GET_FIRMWARE | GB_TYPE_RESPONSE)) {
+            dbgprint("Response wasn't get-FW\n");
+            return -ENODEV;
+        }
     }
 
     return 0;
@@ -158,20 +201,69 @@ static int gbboot_get_firmware(uint32_t offset, uint32_t size, void *data,
 
 static int gbboot_get_firmware_response(gb_operation_header *header, void *data,
                                       uint32_t len) {
+    uint32_t slot = header->id - 1;
+
+    if (slot >= GB_GET_FIRMWARE_WINDOW ||
+        fw_get_firmware_buff[slot].buffer == NULL) {
+        /* left over from a load that failed, nothing is waiting for it */
+        dbgprint("gbboot_get_firmware_response(): stale response\n");
+        return 0;
+    }
     if (header->status) {
         dbgprint("gbboot_get_firmware_response(): err status\n");
         return -header->status;
     }
+#ifdef _UNIPRO_RX_PLACEMENT
+    if (fw_get_firmware_buff[slot].placed) {
+        /* the payload is already where it belongs */
+        fw_get_firmware_buff[slot].buffer = NULL;
+        return 1;
+    }
+#endif
     if (header->size - sizeof(gb_operation_header) != len ||
-        len != fw_get_firmware_buff.size) {
+        len != fw_get_firmware_buff[slot].size) {
         dbgprint("gbboot_get_firmware_response(): wrong response size\n");
         return GB_BOOT_ERR_INVALID;
     }
-    memcpy(fw_get_firmware_buff.buffer, data, fw_get_firmware_buff.size);
+    memcpy(fw_get_firmware_buff[slot].buffer, data, len);
+    fw_get_firmware_buff[slot].buffer = NULL;
     /* return >0 to break out from greybus loop */
     return 1;
 }
 
+#ifdef _UNIPRO_RX_PLACEMENT
+/**
+ * @brief UniPro RX placement for the gbboot CPort
+ *
+ * Called with just the Greybus header of an incoming message. A successful
+ * GET_FIRMWARE response of the expected size has its payload written by the
+ * CPort DMA straight to the load address, which saves copying the whole image
+ * out of the RX buffer. Anything else is received into the RX buffer as usual.
+ */
+static void *gbboot_place_rx(uint32_t cportid, void *header, size_t *len) {
+    gb_operation_header *op_header = header;
+    uint32_t slot = op_header->id - 1;
+    uint32_t size;
+
+    if (op_header->type != (GB_BOOT_OP_GET_FIRMWARE | GB_TYPE_RESPONSE) ||
+        op_header->status != GB_OP_SUCCESS ||
+        slot >= GB_GET_FIRMWARE_WINDOW ||
+        fw_get_firmware_buff[slot].buffer == NULL) {
+        return NULL;
+    }
+
+    size = fw_get_firmware_buff[slot].size;
+    if (op_header->size != sizeof(gb_operation_header) + size ||
+        ((uint32_t)fw_get_firmware_buff[slot].buffer & 0x3) != 0) {
+        return NULL;
+    }
+
+    fw_get_firmware_buff[slot].placed = true;
+    *len = size;
+    return fw_get_firmware_buff[slot].buffer;
+}
+#endif
+
 static int gbboot_ready_to_boot(uint8_t status) {
     int rc;
     struct gbboot_ready_to_boot_request req = {status};
@@ -255,11 +347,15 @@ static int data_load_greybus_init(void) {
     offset = 0;
 
     greybus_register_handlers(GBBOOT_CPORT, gbboot_cport_handlers);
+#ifdef _UNIPRO_RX_PLACEMENT
+    chip_unipro_set_rx_placement(gbboot_cportid, sizeof(gb_operation_header),
+                                 gbboot_place_rx);
+#endif
 
     rc = greybus_loop();
     if (rc) {
         set_last_error(BRE_BOU_GBBOOT_CPORT);
-        return rc;
+        goto protocol_error;
     }
 
     /**
@@ -280,43 +376,107 @@ static int data_load_greybus_init(void) {
     return 0;
 
 protocol_error:
+#ifdef _UNIPRO_RX_PLACEMENT
+    /* no load follows, so no finish to remove the placement either */
+    chip_unipro_set_rx_placement(gbboot_cportid, sizeof(gb_operation_header),
+                                 NULL);
+#endif
     return rc;
 }
 
+static void data_load_greybus_cancel(void) {
+    uint32_t slot;
+
+    for (slot = 0; slot < GB_GET_FIRMWARE_WINDOW; slot++) {
+        fw_get_firmware_buff[slot].buffer = NULL;
+    }
+}
+
 static int data_load_greybus_load(void *dest, uint32_t length, bool hash) {
     int rc;
-    uint32_t blk_len, prev_len = 0;
-    void *prev = NULL;
+    uint32_t blk_len, slot;
+    uint32_t sent = 0, received = 0;
+    uint32_t requested = 0, ready = 0;
+    uint8_t *data = dest;
+
     if (offset + length > firmware_size) {
         return GB_BOOT_ERR_INVALID;
     }
 
-    while (length) {
-        /**
-         * We take whichever is smaller: the largest possible size for a Greybus
-         * message payload, or the remaining length of the firmware blob.
-         */
-        blk_len = (length > GB_MAX_PAYLOAD_SIZE) ? GB_MAX_PAYLOAD_SIZE : length;
-        rc = gbboot_get_firmware(offset, blk_len, dest, prev, prev_len);
-        if (rc) {
-            set_last_error(BRE_BOU_GBBOOT_GET_FW);
-            return rc;
+    /**
+     * Keep up to GB_GET_FIRMWARE_WINDOW requests outstanding. Chunks are
+     * consumed in order: once the oldest one has arrived, its slot is reused
+     * for the next request before the chunk is hashed, so the server is busy
+     * with the requests still in flight while we hash.
+     */
+    while (1) {
+        while (requested < length &&
+               sent - received < GB_GET_FIRMWARE_WINDOW) {
+            /**
+             * We take whichever is smaller: the largest payload the server
+             * agreed to send in one Greybus message, or the remaining length
+             * of the firmware blob.
+             */
+            blk_len = length - requested;
+            if (blk_len > gbboot_chunk_size) {
+                blk_len = gbboot_chunk_size;
+            }
+            rc = gbboot_get_firmware_send(sent % GB_GET_FIRMWARE_WINDOW,
+                                          offset, blk_len,
+                                          (uint8_t *)dest + requested);
+            if (rc) {
+                goto get_fw_error;
+            }
+
+            sent++;
+            offset    += blk_len;
+            requested += blk_len;
         }
 
-        if (hash) {
-            prev = dest;
-            prev_len = blk_len;
+        if (hash && ready > 0) {
+            hash_update((unsigned char*)data, ready);
         }
+        data += ready;
 
-        dest   += blk_len;
-        offset += blk_len;
-        length -= blk_len;
+        if (received == sent) {
+            break;
+        }
+
+        slot = received % GB_GET_FIRMWARE_WINDOW;
+        rc = gbboot_get_firmware_wait(slot);
+        if (rc) {
+            goto get_fw_error;
+        }
+        received++;
+        ready = fw_get_firmware_buff[slot].size;
     }
 
-    if (hash) {
-        hash_update((unsigned char*)prev, prev_len);
+    return 0;
+
+get_fw_error:
+    data_load_greybus_cancel();
+    set_last_error(BRE_BOU_GBBOOT_GET_FW);
+    return rc;
+}
+
+static int data_load_greybus_fetch(void *dest, uint32_t pos,
+                                   uint32_t length) {
+    int rc;
+    int saved_offset = offset;
+
+    offset = pos;
+    rc = data_load_greybus_load(dest, length, false);
+    offset = saved_offset;
+    return rc;
+}
+
+static int data_load_greybus_seek(uint32_t length) {
+    if (offset + length > firmware_size) {
+        return GB_BOOT_ERR_INVALID;
     }
 
+    /* the next GET_FIRMWARE simply asks for the data after the gap */
+    offset += length;
     return 0;
 }
 
@@ -334,8 +494,22 @@ static int data_load_greybus_finish(bool valid, bool is_secure_image) {
     if (rc) {
         set_last_error(BRE_BOU_GBBOOT_READY);
     }
+#ifdef _UNIPRO_RX_PLACEMENT
+    chip_unipro_set_rx_placement(gbboot_cportid, sizeof(gb_operation_header),
+                                 NULL);
+#endif
 
     dbgprint("Finished Greybus FW download\n");
+#ifdef _DEBUGMSGS
+    {
+        uint32_t polls, messages;
+
+        greybus_get_poll_stats(&polls, &messages);
+        if (messages != 0) {
+            dbgprintx32("Greybus polls per message: ", polls / messages, "\n");
+        }
+    }
+#endif
 
     firmware_size = offset = -1;
     return rc;
@@ -345,5 +519,7 @@ data_load_ops greybus_ops = {
     .init = data_load_greybus_init,
     .read = NULL,
     .load = data_load_greybus_load,
-    .finish = data_load_greybus_finish
+    .finish = data_load_greybus_finish,
+    .fetch = data_load_greybus_fetch,
+    .seek = data_load_greybus_seek
 };
@@ -47,27 +47,21 @@ static int greybus_send_message(uint32_t cport,
                                 uint8_t status,
                                 unsigned char *payload_data,
                                 uint16_t payload_size) {
-    /**
-     * the payload_size are all pretty small for Greybus Control protocol
-     * and the firmware downloading protocol on the boot ROM side.
-     * So we can use the variable sized array here and not worrying
-     * about running out of stack space
-     */
-    unsigned char msg[sizeof(gb_operation_header) + payload_size];
-
-    gb_operation_header *msg_header = (gb_operation_header *)msg;
-    unsigned char *payload = &msg[sizeof(gb_operation_header)];
-
-    msg_header->size    = sizeof(msg);
-    msg_header->id      = id;
-    msg_header->type    = type;
-    msg_header->status  = status;
-    msg_header->padding = 0;
-
-    if (payload_size != 0 && payload_data != NULL) {
-        memcpy(payload, payload_data, payload_size);
+    gb_operation_header msg_header;
+
+    if (payload_data == NULL) {
+        payload_size = 0;
     }
-    return chip_unipro_send(cport, msg, sizeof(msg));
+
+    msg_header.size    = sizeof(msg_header) + payload_size;
+    msg_header.id      = id;
+    msg_header.type    = type;
+    msg_header.status  = status;
+    msg_header.padding = 0;
+
+    /* the payload goes out from where it is, behind the header */
+    return chip_unipro_send(cport, &msg_header, sizeof(msg_header),
+                            payload_data, payload_size);
 }
 
 int greybus_send_request(uint32_t cport,
@@ -196,6 +190,12 @@ static int gbctrl_disconnected(uint32_t cportid,
 }
 
 static greybus_op_handler *handler_table[CPORT_MAX];
+/* bit n is set if handler_table[n] is, see greybus_loop */
+static uint32_t handler_cports;
+
+/* greybus_loop iterations and messages received, see greybus_get_poll_stats */
+static uint32_t greybus_polls;
+static uint32_t greybus_messages;
 
 int common_cport_handler(uint32_t cportid,
                          void *data,
@@ -217,6 +217,8 @@ int common_cport_handler(uint32_t cportid,
 
     gb_operation_header *op_header = (gb_operation_header *)data;
 
+    greybus_messages++;
+
     greybus_op_handler_func handler = NULL;
     i = 0;
     while (handler_table[cportid] != NULL &&
@@ -251,6 +253,11 @@ static greybus_op_handler control_cport_handlers[] = {
 void greybus_register_handlers(uint32_t cportid,
                                greybus_op_handler *handlers) {
     handler_table[cportid] = handlers;
+    if (handlers != NULL) {
+        handler_cports |= (1 << cportid);
+    } else {
+        handler_cports &= ~(1 << cportid);
+    }
 }
 
 int greybus_init(void) {
@@ -260,32 +267,62 @@ int greybus_init(void) {
     for (i = 0; i < CPORT_MAX; i++) {
         handler_table[i] = NULL;
     }
+    handler_cports = 0;
 
     rc = chip_unipro_init_cport(CONTROL_CPORT);
     greybus_register_handlers(CONTROL_CPORT, control_cport_handlers);
     return rc;
 }
 
+/*
+ * is_mailbox_irq_pending() is a DME attribute read, which takes much longer
+ * than checking the CPort RX status. Mailbox traffic is rare, so it is only
+ * checked every GB_MAILBOX_POLL_INTERVAL iterations of greybus_loop.
+ */
+#define GB_MAILBOX_POLL_INTERVAL 64
+static uint32_t mailbox_poll_countdown;
+
 int greybus_loop(void) {
     int rc;
-    uint32_t cportid;
     uint32_t mbox;
 
     while(1) {
-        if (is_mailbox_irq_pending()) {
-            chip_unipro_recv_cport(&mbox);
-        }
-        for (cportid = 0; cportid < CPORT_MAX; cportid++) {
-            if (handler_table[cportid]) {
-                rc = unipro_receive(cportid, common_cport_handler);
-                if (rc < 0) {
-                    return -1;
-                }
-                if (rc > 0) {
-                    return 0;
-                }
+        if (mailbox_poll_countdown == 0) {
+            mailbox_poll_countdown = GB_MAILBOX_POLL_INTERVAL;
+            if (is_mailbox_irq_pending()) {
+                chip_unipro_recv_cport(&mbox);
             }
         }
+        mailbox_poll_countdown--;
+        greybus_polls++;
+
+        rc = chip_unipro_receive_ready(handler_cports, common_cport_handler);
+        if (rc < 0) {
+            return -1;
+        }
+        if (rc > 0) {
+            return 0;
+        }
+
+        if (chip_unipro_wait_event()) {
+            /* mail is signalled by the DME interrupt, check it right away */
+            mailbox_poll_countdown = 0;
+        }
     }
     return 0;
 }
+
+/**
+ * @brief Get the number of polls greybus_loop did and messages it received
+ *
+ * The ratio of the two shows how much time is spent polling for nothing.
+ *
+ * @param polls Where to store the number of iterations of greybus_loop
+ * @param messages Where to store the number of messages handled
+ *
+ * @returns Nothing
+ */
+void greybus_get_poll_stats(uint32_t *polls, uint32_t *messages) {
+    *polls = greybus_polls;
+    *messages = greybus_messages;
+}
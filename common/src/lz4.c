@@ -0,0 +1,225 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "bootrom.h"
+#include "error.h"
+#include "lz4.h"
+
+/*
+ * LZ4 block format: each sequence starts with a token byte holding the
+ * literal count in its high nibble and the match length minus 4 in its low
+ * nibble. A nibble of 15 is extended by the following bytes, which are added
+ * to it up to and including the first byte that isn't 255. The literals come
+ * next, then a 16-bit little-endian offset back into the output and the
+ * match length extension. The last sequence stops after its literals.
+ *
+ * Matches refer to data already expanded into the destination, so the only
+ * buffering needed is for the compressed input.
+ */
+#define LZ4_MIN_MATCH   4
+#define LZ4_RUN_MASK    15
+
+static struct {
+    data_load_ops *ops;
+    bool hash;
+    uint32_t remaining; /* compressed bytes not loaded yet */
+    uint32_t pos;       /* next byte in lz4_in */
+    uint32_t len;       /* bytes in lz4_in */
+} lz4_src;
+
+/* aligned so Greybus can receive straight into it */
+static unsigned char lz4_in[LZ4_INPUT_BUFFER_SIZE] __attribute__ ((aligned(4)));
+
+/**
+ * @brief Load the next block of compressed data
+ *
+ * @returns 0 on success, -1 if there is no more data or loading failed
+ */
+static int lz4_fill(void) {
+    uint32_t n = lz4_src.remaining;
+
+    if (n == 0) {
+        set_last_error(BRE_TFTF_COMPRESSION_BAD);
+        return -1;
+    }
+
+    if (n > sizeof(lz4_in)) {
+        n = sizeof(lz4_in);
+    }
+    if (lz4_src.ops->load(lz4_in, n, lz4_src.hash)) {
+        set_last_error(BRE_TFTF_LOAD_DATA);
+        return -1;
+    }
+
+    lz4_src.remaining -= n;
+    lz4_src.pos = 0;
+    lz4_src.len = n;
+    return 0;
+}
+
+static int lz4_getc(void) {
+    if (lz4_src.pos == lz4_src.len && lz4_fill()) {
+        return -1;
+    }
+    return lz4_in[lz4_src.pos++];
+}
+
+static bool lz4_done(void) {
+    return lz4_src.remaining == 0 && lz4_src.pos == lz4_src.len;
+}
+
+/**
+ * @brief Add the extension bytes to a literal count or match length
+ *
+ * @param length The nibble from the token, updated with the extension
+ *
+ * @returns 0 on success, -1 on error
+ */
+static int lz4_get_length(uint32_t *length) {
+    int c;
+
+    if (*length != LZ4_RUN_MASK) {
+        return 0;
+    }
+
+    do {
+        c = lz4_getc();
+        if (c < 0) {
+            return -1;
+        }
+        *length += c;
+    } while (c == 255);
+
+    return 0;
+}
+
+/**
+ * @brief Load an LZ4 compressed block and expand it
+ *
+ * The compressed data is loaded through ops->load, a block at a time, so it
+ * is hashed as it arrives if requested. The output has to fill exactly
+ * expanded_length bytes at dest, and no match may reach outside of it.
+ *
+ * @param ops Pointer to the media access V-table
+ * @param dest Where to expand the data to
+ * @param expanded_length Size of the expanded data
+ * @param length Size of the compressed data
+ * @param hash Whether the compressed data should be hashed
+ *
+ * @returns 0 on success, -1 on error (with the error set)
+ */
+int lz4_load(data_load_ops *ops, void *dest, uint32_t expanded_length,
+             uint32_t length, bool hash) {
+    unsigned char *start = dest;
+    unsigned char *out = start;
+    unsigned char *out_end = start + expanded_length;
+    unsigned char *match;
+    uint32_t literals, match_length, offset, n;
+    int token, lo, hi;
+
+    lz4_src.ops = ops;
+    lz4_src.hash = hash;
+    lz4_src.remaining = length;
+    lz4_src.pos = 0;
+    lz4_src.len = 0;
+
+    while (!lz4_done()) {
+        token = lz4_getc();
+        if (token < 0) {
+            return -1;
+        }
+
+        literals = token >> 4;
+        if (lz4_get_length(&literals)) {
+            return -1;
+        }
+        if (literals > (uint32_t)(out_end - out)) {
+            goto corrupted;
+        }
+        while (literals > 0) {
+            if (lz4_src.pos == lz4_src.len && lz4_fill()) {
+                return -1;
+            }
+            n = lz4_src.len - lz4_src.pos;
+            if (n > literals) {
+                n = literals;
+            }
+            memcpy(out, &lz4_in[lz4_src.pos], n);
+            lz4_src.pos += n;
+            out += n;
+            literals -= n;
+        }
+
+        if (lz4_done()) {
+            break;
+        }
+
+        lo = lz4_getc();
+        if (lo < 0) {
+            return -1;
+        }
+        hi = lz4_getc();
+        if (hi < 0) {
+            return -1;
+        }
+        offset = lo | (hi << 8);
+        if (offset == 0 || offset > (uint32_t)(out - start)) {
+            goto corrupted;
+        }
+
+        match_length = token & LZ4_RUN_MASK;
+        if (lz4_get_length(&match_length)) {
+            return -1;
+        }
+        match_length += LZ4_MIN_MATCH;
+        if (match_length > (uint32_t)(out_end - out)) {
+            goto corrupted;
+        }
+
+        match = out - offset;
+        if (offset >= match_length) {
+            memcpy(out, match, match_length);
+            out += match_length;
+        } else {
+            /* the match overlaps the data it produces: byte by byte */
+            while (match_length--) {
+                *out++ = *match++;
+            }
+        }
+    }
+
+    if (out == out_end) {
+        return 0;
+    }
+
+corrupted:
+    set_last_error(BRE_TFTF_COMPRESSION_BAD);
+    return -1;
+}
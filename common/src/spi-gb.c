@@ -130,6 +130,12 @@ static int gb_spi_type_device_config(uint32_t cportid,
                                sizeof(payload));
 }
 
+/*
+ * Transfer response payload. The data read is received into it, and
+ * chip_unipro_send copies it out behind the response header.
+ */
+static uint32_t transfer_response[GB_LARGE_PAYLOAD_SIZE / 4];
+
 static int gb_spi_transfer(uint32_t cportid, gb_operation_header *op_header) {
     struct gb_spi_transfer_desc *desc;
     struct gb_spi_transfer_request *request;
@@ -178,8 +184,15 @@ static int gb_spi_transfer(uint32_t cportid, gb_operation_header *op_header) {
         }
     }
 
-    unsigned char payload[size];
-    response = (struct gb_spi_transfer_response *)payload;
+    if (size > GB_LARGE_PAYLOAD_SIZE) {
+        greybus_op_response(cportid,
+                            op_header,
+                            GB_OP_INVALID,
+                            NULL,
+                            0);
+        return -1;
+    }
+    response = (struct gb_spi_transfer_response *)transfer_response;
     read_buf = response->data;
 
     /* set SPI mode */
@@ -266,8 +279,7 @@ static int gb_spi_transfer(uint32_t cportid, gb_operation_header *op_header) {
 spi_err:
     if (selected) {
         /* deassert chip-select pin */
-        ret = device_spi_deselect(spi_dev, request->chip_select);
-        if (ret) {
+        if (device_spi_deselect(spi_dev, request->chip_select)) {
             greybus_op_response(cportid,
                             op_header,
                             GB_OP_UNKNOWN_ERROR,
@@ -276,6 +288,15 @@ spi_err:
             return -1;
         }
     }
+    if (ret) {
+        /* the data read is incomplete, don't send it */
+        greybus_op_response(cportid,
+                            op_header,
+                            GB_OP_UNKNOWN_ERROR,
+                            NULL,
+                            0);
+        return -1;
+    }
     return greybus_op_response(cportid,
                               op_header,
                               GB_OP_SUCCESS,
@@ -37,6 +37,8 @@
 #include "unipro.h"
 #include "utils.h"
 #include "error.h"
+#include "boot_profile.h"
+#include "lz4.h"
 
 /**
  * Crypto state is used when parsing TFTF image:
@@ -70,6 +72,9 @@ typedef struct {
     unsigned char hash[SHA256_HASH_DIGEST_SIZE];
     tftf_signature signature;
     bool contain_signature;
+    /* first signature, fetched ahead so it can be checked while loading */
+    tftf_signature prefetched;
+    tftf_section_descriptor *prefetched_section;
 } tftf_processing_state;
 
 static tftf_processing_state tftf;
@@ -93,6 +98,7 @@ static int load_tftf_header(data_load_ops *ops) {
 
     tftf.crypto_state = CRYPTO_STATE_INIT;
     tftf.contain_signature = false;
+    tftf.prefetched_section = NULL;
 
     /* load the beginning of the TFTF header */
     if (ops->load(&header->buffer[0], TFTF_HEADER_SIZE_MIN, false)) {
@@ -103,13 +109,13 @@ static int load_tftf_header(data_load_ops *ops) {
     /* Verify the sentinel */
     if (memcmp(header->sentinel_value, tftf_sentinel, TFTF_SENTINEL_SIZE)) {
         set_last_error(BRE_TFTF_SENTINEL);
-        return false;
+        return -1;
     }
 
     if (header->header_size < TFTF_HEADER_SIZE_MIN ||
         header->header_size > MAX_TFTF_HEADER_SIZE_SUPPORTED) {
         set_last_error(BRE_TFTF_HEADER_SIZE);
-        return false;
+        return -1;
     }
 
     if (header->header_size != TFTF_HEADER_SIZE_MIN) {
@@ -202,11 +208,6 @@ static int load_tftf_header(data_load_ops *ops) {
             }
             break;
 
-        case TFTF_SECTION_COMPRESSED_CODE:
-        case TFTF_SECTION_COMPRESSED_DATA:
-            set_last_error(BRE_TFTF_COMPRESSION_UNSUPPORTED);
-            return -1;
-
         default:
             if (tftf.crypto_state == CRYPTO_STATE_HASHING) {
                 set_last_error(BRE_TFTF_HASHED_SECTION_AFTER_UNHASHED);
@@ -221,6 +222,44 @@ static int load_tftf_header(data_load_ops *ops) {
     return 0;
 }
 
+/**
+ * @brief Fetch the first signature of the TFTF ahead of its section data
+ *
+ * The RSA part of the signature check does not depend on the image digest,
+ * so if the media can read out of order, fetch the signature now and let the
+ * check run while the sections are being loaded. The signature is still
+ * loaded in order later on, and the early check is only used if both agree.
+ * Any failure here just means the signature is checked the usual way.
+ *
+ * @param ops Pointer to the media access V-table
+ *
+ * @returns Nothing
+ */
+static void prefetch_signature(data_load_ops *ops) {
+    tftf_section_descriptor *section;
+    uint32_t offset = tftf.header.header_size;
+
+    if (ops->fetch == NULL) {
+        return;
+    }
+
+    section = &tftf.header.sections[0];
+    while(!is_section_out_of_range(&tftf.header, section) &&
+          section->section_type != TFTF_SECTION_END) {
+        if (section->section_type == TFTF_SECTION_SIGNATURE) {
+            if (ops->fetch(&tftf.prefetched, offset,
+                           sizeof(tftf.prefetched)) == 0 &&
+                verify_signature_start(&tftf.prefetched) == 0) {
+                tftf.prefetched_section = section;
+            }
+            return;
+        }
+        /* same amount as process_tftf_section takes from the stream */
+        offset += section->section_length;
+        section++;
+    }
+}
+
 #define TEMP_BUFFER_SIZE 2048
 static int discard_section(data_load_ops *ops,
                            tftf_section_descriptor *section,
@@ -229,6 +268,11 @@ static int discard_section(data_load_ops *ops,
     uint32_t len = section->section_length;
     uint32_t blk_len;
 
+    if (!hash_section && ops->seek != NULL) {
+        /* nothing needs the data, don't transfer it at all */
+        return ops->seek(len);
+    }
+
     while (len) {
         blk_len = (len > sizeof(temp)) ? sizeof(temp) : len;
         if (ops->load(temp, blk_len, hash_section)) {
@@ -255,11 +299,13 @@ static int process_tftf_section(data_load_ops *ops,
                                 tftf_section_descriptor *section) {
     uint32_t dest;
     bool hash_loaded_data = false;
+    int rc;
 
     if (!is_section_hashed(section) &&
         tftf.crypto_state == CRYPTO_STATE_HASHING) {
         hash_final(tftf.hash);
         tftf.crypto_state = CRYPTO_STATE_HASHED;
+        boot_profile_mark(BOOT_PHASE_HASH_FINAL, 0);
     }
 
     if (section->section_type == TFTF_SECTION_SIGNATURE) {
@@ -268,9 +314,17 @@ static int process_tftf_section(data_load_ops *ops,
             return -1;
         }
         if (tftf.crypto_state == CRYPTO_STATE_HASHED) {
-            if (verify_signature(tftf.hash, &tftf.signature) == 0) {
+            if (section == tftf.prefetched_section &&
+                !memcmp(&tftf.signature, &tftf.prefetched,
+                        sizeof(tftf.signature))) {
+                rc = verify_signature_finish(tftf.hash, &tftf.prefetched);
+            } else {
+                rc = verify_signature(tftf.hash, &tftf.signature);
+            }
+            if (rc == 0) {
                 tftf.crypto_state = CRYPTO_STATE_VERIFIED;
             }
+            boot_profile_mark(BOOT_PHASE_VERIFY_SIGNATURE, 0);
         }
         return 0;
     }
@@ -287,6 +341,16 @@ static int process_tftf_section(data_load_ops *ops,
             return -1;
         }
     }
+    else if (section->section_type == TFTF_SECTION_COMPRESSED_CODE ||
+             section->section_type == TFTF_SECTION_COMPRESSED_DATA) {
+        if (lz4_load(ops, CHIP_IMAGE_LOADING_DEST(dest),
+                     section->section_expanded_length,
+                     section->section_length,
+                     hash_loaded_data)) {
+            /* (lz4_load took care of error reporting) */
+            return -1;
+        }
+    }
     else if (ops->load(CHIP_IMAGE_LOADING_DEST(dest),
                        section->section_length,
                        hash_loaded_data)) {
@@ -297,7 +361,16 @@ static int process_tftf_section(data_load_ops *ops,
     return 0;
 }
 
-int load_tftf_image(data_load_ops *ops, uint32_t *is_secure_image) {
+/**
+ * @brief Load and validate the TFTF image at the current position
+ *
+ * @param ops The data loading operations to load the image with
+ * @param is_secure_image Set to 1 if the image was loaded and verified
+ *
+ * @returns 0 on success, <0 on error
+ */
+static int load_tftf_image_once(data_load_ops *ops,
+                                uint32_t *is_secure_image) {
     tftf_section_descriptor *section;
 
     *is_secure_image = 0;
@@ -306,6 +379,9 @@ int load_tftf_image(data_load_ops *ops, uint32_t *is_secure_image) {
         /* (load_tftf_header took care of error reporting) */
         return -1;
     }
+    boot_profile_mark(BOOT_PHASE_TFTF_HEADER, 0);
+
+    prefetch_signature(ops);
 
     section = &tftf.header.sections[0];
     /**
@@ -320,6 +396,8 @@ int load_tftf_image(data_load_ops *ops, uint32_t *is_secure_image) {
              */
             return -1;
         }
+        boot_profile_mark(BOOT_PHASE_TFTF_SECTION,
+                          section - &tftf.header.sections[0]);
         section++;
     }
 
@@ -369,9 +447,28 @@ int load_tftf_image(data_load_ops *ops, uint32_t *is_secure_image) {
     return 0;
 }
 
+int load_tftf_image(data_load_ops *ops, uint32_t *is_secure_image) {
+    while (load_tftf_image_once(ops, is_secure_image)) {
+        /*
+         * An image from storage may have older copies in the FFFF table
+         * (e.g. the other half of an A/B update): try them, newest first,
+         * before giving up on the storage.
+         */
+        if (ops->read == NULL || locate_next_ffff_element(ops, NULL)) {
+            /* (the failed load took care of error reporting) */
+            return -1;
+        }
+        dbgprint("TFTF image failed, trying an older copy\n");
+        chip_clear_image_loading_ram();
+        reset_last_error();
+    }
+    return 0;
+}
+
 void jump_to_image(void) {
     chip_reset_before_jump();
     dbgflush();
+    boot_profile_mark(BOOT_PHASE_JUMP, 0);
     chip_jump_to_image(tftf.header.start_location);
 }
 
@@ -450,7 +547,8 @@ bool valid_tftf_section(tftf_section_descriptor * section,
     /* Does the section contain the entry point? */
     if ((header->start_location >= section_start) &&
         (header->start_location < section_end) &&
-        (section->section_type == TFTF_SECTION_RAW_CODE)) {
+        (section->section_type == TFTF_SECTION_RAW_CODE ||
+         section->section_type == TFTF_SECTION_COMPRESSED_CODE)) {
         *section_contains_start = true;
     }
 
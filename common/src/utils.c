@@ -30,42 +30,99 @@
 #include <utils.h>
 
 /*
- * Compared to crypto functions, time spent in the memcpy can be ignored,
- * so let's keep it simple instead of optmizing for speed at this moment.
+ * memcpy/memset/memcmp run on every Greybus chunk, on header copies and when
+ * clearing the image RAM, so the bulk of each buffer is handled a word at a
+ * time (four words per iteration, which the compiler can turn into LDM/STM).
+ * Bytes are only used for an unaligned head and tail, or when the two
+ * buffers have different alignment.
  */
+#define WORD_MASK   (sizeof(uint32_t) - 1)
+#define BLOCK_SIZE  (4 * sizeof(uint32_t))
+
 void *memcpy(void *dest, const void *src, size_t n) {
-    size_t i;
     unsigned char *pd = (unsigned char*)dest;
     const unsigned char *ps = (const unsigned char*)src;
+    uint32_t *wd;
+    const uint32_t *ws;
 
     /*
      * Parameter validation is skipped here, since this is used internally
      * only and the paramters are expected to be vailidated by caller
      */
 
-    for (i = 0; i < n; i++) {
+    if ((((uintptr_t)pd ^ (uintptr_t)ps) & WORD_MASK) == 0) {
+        while (n > 0 && ((uintptr_t)pd & WORD_MASK) != 0) {
+            *pd++ = *ps++;
+            n--;
+        }
+
+        wd = (uint32_t *)pd;
+        ws = (const uint32_t *)ps;
+        while (n >= BLOCK_SIZE) {
+            uint32_t w0 = ws[0], w1 = ws[1], w2 = ws[2], w3 = ws[3];
+            wd[0] = w0;
+            wd[1] = w1;
+            wd[2] = w2;
+            wd[3] = w3;
+            wd += 4;
+            ws += 4;
+            n -= BLOCK_SIZE;
+        }
+        while (n >= sizeof(uint32_t)) {
+            *wd++ = *ws++;
+            n -= sizeof(uint32_t);
+        }
+        pd = (unsigned char *)wd;
+        ps = (const unsigned char *)ws;
+    }
+
+    while (n-- > 0) {
         *pd++ = *ps++;
     }
     return dest;
 }
 
 void *memset(void *s, int c, size_t n) {
-    size_t i;
     unsigned char *pd = (unsigned char*)s;
+    uint32_t *wd;
+    uint32_t w;
 
     /*
      * Parameter validation is skipped here, since this is used internally
      * only and the paramters are expected to be vailidated by caller
      */
 
-    for (i = 0; i < n; i++) {
+    while (n > 0 && ((uintptr_t)pd & WORD_MASK) != 0) {
+        *pd++ = c;
+        n--;
+    }
+
+    w = (unsigned char)c;
+    w |= w << 8;
+    w |= w << 16;
+    wd = (uint32_t *)pd;
+    while (n >= BLOCK_SIZE) {
+        wd[0] = w;
+        wd[1] = w;
+        wd[2] = w;
+        wd[3] = w;
+        wd += 4;
+        n -= BLOCK_SIZE;
+    }
+    while (n >= sizeof(uint32_t)) {
+        *wd++ = w;
+        n -= sizeof(uint32_t);
+    }
+
+    pd = (unsigned char *)wd;
+    while (n-- > 0) {
         *pd++ = c;
     }
     return s;
 }
 
 int memcmp(const void *s1, const void *s2, size_t n) {
-    size_t i;
+    size_t i = 0;
     unsigned char *p1 = (unsigned char *)s1;
     unsigned char *p2 = (unsigned char *)s2;
 
@@ -74,7 +131,15 @@ int memcmp(const void *s1, const void *s2, size_t n) {
      * only and the paramters are expected to be vailidated by caller
      */
 
-    for (i = 0; i < n; i++) {
+    /* skip over equal words, the byte loop below finds the ordering */
+    if ((((uintptr_t)p1 | (uintptr_t)p2) & WORD_MASK) == 0) {
+        while (i + sizeof(uint32_t) <= n &&
+               *(uint32_t *)&p1[i] == *(uint32_t *)&p2[i]) {
+            i += sizeof(uint32_t);
+        }
+    }
+
+    for (; i < n; i++) {
         if (p1[i] != p2[i]) {
             return p1[i] - p2[i];
         }
@@ -56,6 +56,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.             *
 
 	Stack requirement - just over 4 time size of RSA Public key, so for 2048-bit key that is 1024 bytes
 	CPU requirement - does not require multiplication or division for SMALL_AND_SLOW version
+	                  MONTGOMERY needs multiplication, but no division
 	Compiler requirement - minimal C 
 
     Note that this is a completely standalone module - it calls no MIRACL functions.
@@ -106,8 +107,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.             *
 
 /* define one of these */
 
+#if !defined(SMALL_AND_SLOW) && !defined(FAST_BUT_BIGGER) && !defined(MONTGOMERY)
 //#define SMALL_AND_SLOW
-#define FAST_BUT_BIGGER
+//#define FAST_BUT_BIGGER
+#define MONTGOMERY
+#endif
 
 /* a C integer type of CPU Register Size. Can be architecture dependent. */
 /* DO NOT be tempted to specify a type greater than CPU wordlength - */
@@ -243,6 +247,38 @@ void shs256_process(sha256 *sh,int byte)
     if ((sh->length[0]%512)==0) shs_transform(sh);
 }
 
+void shs256_process_block(sha256 *sh,const char *data,unsigned int len)
+{ /* process a run of message bytes, whole 64-byte blocks at a time */
+    int j;
+    const unsigned char *p=(const unsigned char *)data;
+
+/* finish off any partial block left over from a previous call */
+    while (len>0 && (sh->length[0]%512)!=0)
+    {
+        shs256_process(sh,*p++);
+        len--;
+    }
+
+/* whole blocks go straight into the message schedule */
+    while (len>=64)
+    {
+        for (j=0;j<16;j++,p+=4)
+            sh->w[j]=((unsign32)p[0]<<24)|((unsign32)p[1]<<16)|
+                     ((unsign32)p[2]<<8)|(unsign32)p[3];
+        sh->length[0]+=512;
+        if (sh->length[0]<512) sh->length[1]++;
+        shs_transform(sh);
+        len-=64;
+    }
+
+/* and the tail is left in w[] for the next call or for shs256_hash */
+    while (len>0)
+    {
+        shs256_process(sh,*p++);
+        len--;
+    }
+}
+
 void shs256_hash(sha256 *sh,char hash[32])
 { /* pad message and finish - supply digest */
     int i;
@@ -264,7 +300,7 @@ void shs256_hash(sha256 *sh,char hash[32])
 /* SHA256 identifier string */
 const char SHA256ID[]={0x30,0x31,0x30,0x0d,0x06,0x09,0x60,0x86,0x48,0x01,0x65,0x03,0x04,0x02,0x01,0x05,0x00,0x04,0x20};
 
-#ifdef SMALL_AND_SLOW
+#if defined(SMALL_AND_SLOW) || defined(MONTGOMERY)
 /* set x=0 */
 static void tr_zero(BIG x[])
 {
@@ -293,7 +329,7 @@ static int tr_compare(BIG x[],BIG y[])
 	return 0;
 }
 
-#ifdef SMALL_AND_SLOW
+#if defined(SMALL_AND_SLOW) || defined(MONTGOMERY)
 
 /* shift Left by 1 bit (multiply by 2) */
 static BIG tr_shift(BIG x[])
@@ -309,6 +345,10 @@ static BIG tr_shift(BIG x[])
 	return c;
 }
 
+#endif
+
+#ifdef SMALL_AND_SLOW
+
 /* add x to y */
 static BIG tr_add(BIG x[],BIG y[])
 {
@@ -324,6 +364,10 @@ static BIG tr_add(BIG x[],BIG y[])
 	return c;
 }
 
+#endif
+
+#if defined(SMALL_AND_SLOW) || defined(MONTGOMERY)
+
 /* subtract x from y */
 static BIG tr_sub(BIG x[],BIG y[])
 {
@@ -339,6 +383,10 @@ static BIG tr_sub(BIG x[],BIG y[])
 	return b;
 }
 
+#endif
+
+#ifdef SMALL_AND_SLOW
+
 /* returns i-th bit of x */
 
 static int tr_bit(int i,BIG x[])
@@ -474,6 +522,87 @@ static void tr_modmul(BIG a[],BIG b[],BIG m[],BIG r[])
 
 #endif
 
+#ifdef MONTGOMERY
+
+/* n0=-1/m[0] mod 2^REGBITS by Newton iteration. m must be odd */
+static BIG tr_mont_n0(BIG m[])
+{
+	int i;
+	BIG x=m[0];  /* good to 3 bits, as m[0]*m[0]=1 mod 8 */
+	for (i=3;i<REGBITS;i<<=1)
+		x*=2-m[0]*x;  /* each step doubles the number of good bits */
+	return (BIG)0-x;
+}
+
+/* Montgomery modular multiplication r=a*b/R mod m, where R=2^RSABITS
+   Coarsely Integrated Operand Scanning (CIOS) method - no division needed
+   r may be the same as a or b */
+static void tr_montmul(BIG a[],BIG b[],BIG m[],BIG n0,BIG r[])
+{
+	int i,j;
+	BIG carry,q;
+	BIG t[MODSIZE+2];
+	DBIG dble;
+
+	for (i=0;i<MODSIZE+2;i++) t[i]=0;
+
+	for (i=0;i<MODSIZE;i++)
+	{
+		carry=0;
+		for (j=0;j<MODSIZE;j++)
+		{ /* t+=a*b[i] */
+			dble=(DBIG)a[j]*b[i]+t[j]+carry;
+			t[j]=(BIG)dble;
+			carry=(BIG)(dble>>REGBITS);
+		}
+		dble=(DBIG)t[MODSIZE]+carry;
+		t[MODSIZE]=(BIG)dble;
+		t[MODSIZE+1]=(BIG)(dble>>REGBITS);
+
+		q=t[0]*n0;  /* so that t+q*m is divisible by 2^REGBITS */
+		dble=(DBIG)q*m[0]+t[0];
+		carry=(BIG)(dble>>REGBITS);
+		for (j=1;j<MODSIZE;j++)
+		{ /* t=(t+q*m)/2^REGBITS */
+			dble=(DBIG)q*m[j]+t[j]+carry;
+			t[j-1]=(BIG)dble;
+			carry=(BIG)(dble>>REGBITS);
+		}
+		dble=(DBIG)t[MODSIZE]+carry;
+		t[MODSIZE-1]=(BIG)dble;
+		t[MODSIZE]=t[MODSIZE+1]+(BIG)(dble>>REGBITS);
+	}
+
+/* t<2m, so one subtraction is enough */
+	if (t[MODSIZE] || tr_compare(t,m)>=0) tr_sub(m,t);
+	tr_copy(t,r);
+}
+
+/* r2=R^2 mod m, used to move numbers into Montgomery form */
+static void tr_mont_r2(BIG m[],BIG n0,BIG r2[])
+{
+	int i;
+	BIG c;
+
+/* R mod m = R-m for any full size modulus */
+	tr_zero(r2);
+	tr_sub(m,r2);
+	while (tr_compare(r2,m)>=0) tr_sub(m,r2);
+
+/* double up to 2^64.R mod m... */
+	for (i=0;i<64;i++)
+	{
+		c=tr_shift(r2);
+		if (c || tr_compare(r2,m)>=0) tr_sub(m,r2);
+	}
+
+/* ...then square our way up to 2^RSABITS.R = R^2 mod m */
+	for (i=64;i<RSABITS;i<<=1)
+		tr_montmul(r2,r2,m,n0,r2);
+}
+
+#endif
+
 /* force char b into index byte position in x */
 static void tr_putbyte(char b,int index,BIG x[])
 {
@@ -487,6 +616,48 @@ static void tr_putbyte(char b,int index,BIG x[])
 	x[el]|=((BIG)(unsigned char)b<<(8*bp));
 }
 
+#ifdef MONTGOMERY
+#if EXPON==65537
+#define MONT_SQUARINGS 16
+#endif
+#if EXPON==3
+#define MONT_SQUARINGS 1
+#endif
+
+/* state of a sliced s^EXPON mod n, see rsa_pow_start() */
+typedef struct
+{
+	BIG *n;
+	BIG n0;
+	BIG *r2;
+	int step;
+	BIG s[MODSIZE];
+	BIG c[MODSIZE];
+} rsa_pow_job;
+
+/* c=s^EXPON mod m, given n0=-1/m mod 2^REGBITS and r2=R^2 mod m */
+static void tr_mont_pow(BIG m[],BIG n0,BIG r2[],BIG s[],BIG c[])
+{
+	int i;
+
+	tr_montmul(s,r2,m,n0,c);  /* into Montgomery form */
+/* ^65536 or ^2 */
+	for (i=0;i<MONT_SQUARINGS;i++)
+		tr_montmul(c,c,m,n0,c);  /* square... */
+/* multiplying by s (not in Montgomery form) also takes us back out of it */
+	tr_montmul(c,s,m,n0,c);  /* and multiply */
+}
+
+/* c=s^EXPON mod m */
+static void tr_rsa_pow(BIG m[],BIG s[],BIG c[])
+{
+	BIG n0,r2[MODSIZE];
+
+	n0=tr_mont_n0(m);
+	tr_mont_r2(m,n0,r2);
+	tr_mont_pow(m,n0,r2,s,c);
+}
+#else
 /* c=s^EXPON mod m */
 static void tr_rsa_pow(BIG m[],BIG s[],BIG c[])
 {
@@ -509,6 +680,7 @@ static void tr_rsa_pow(BIG m[],BIG s[],BIG c[])
 #endif
 	tr_modmul(s,t,m,c);  /* and multiply */
 }
+#endif
 
 /* Convert from char array to BIG */
 static void tr_convert(char *n,BIG pk[])
@@ -559,19 +731,12 @@ void pkcs_v15(char *h,char m[])
 
 }
 
-/* RSA verification - inputs are Message Digest, Public Key, and purported Signature.
-   Returns 1 if signature is correct, else 0 
-*/
-
-int rsa_verify(char h[],char pub[],char sig[])
+/* Compare c with the PKCS#1 V1.5 padded digest h. Returns 1 if they match, else 0 */
+static int tr_check_padding(char h[],BIG c[])
 {
-	BIG c[MODSIZE],n[MODSIZE],s[MODSIZE],d[MODSIZE];
+	BIG d[MODSIZE],diff;
 	int i;
 
-/* Convert parameters from char * to BIG format */
-	tr_convert(pub,n);
-	tr_convert(sig,s);
-
 /* Pad Digest */
 //	pkcs_v15(h,p);
 //	tr_convert(p,d);
@@ -584,11 +749,99 @@ int rsa_verify(char h[],char pub[],char sig[])
     tr_putbyte(0,51,d);
     for (i=52;i<RSABYTES-2;i++) tr_putbyte(0xff,i,d);
 
-	tr_rsa_pow(n,s,c);
-	if (tr_compare(d,c)==0) return 1;
+/* Compare in constant time - the run time does not depend on where (or
+   whether) the padded digest and the recovered one differ */
+	diff=0;
+	for (i=0;i<MODSIZE;i++) diff|=(d[i]^c[i]);
+	if (diff==0) return 1;
 	return 0;
 }
 
+/* RSA verification - inputs are Message Digest, Public Key, and purported Signature.
+   Returns 1 if signature is correct, else 0 
+*/
+
+int rsa_verify(char h[],char pub[],char sig[])
+{
+	BIG c[MODSIZE],n[MODSIZE],s[MODSIZE];
+
+/* Convert parameters from char * to BIG format */
+	tr_convert(pub,n);
+	tr_convert(sig,s);
+
+	tr_rsa_pow(n,s,c);
+	return tr_check_padding(h,c);
+}
+
+#ifdef MONTGOMERY
+
+/* RSA verification with a precomputed Public Key - inputs are Message Digest,
+   the modulus n in BIG format, n0=-1/n mod 2^REGBITS, r2=R^2 mod n, and
+   purported Signature. Skips all of the per-key setup of rsa_verify.
+   Returns 1 if signature is correct, else 0
+*/
+
+int rsa_verify_mont(char h[],BIG n[],BIG n0,BIG r2[],char sig[])
+{
+	BIG c[MODSIZE],s[MODSIZE];
+
+	tr_convert(sig,s);
+
+	tr_mont_pow(n,n0,r2,s,c);
+	return tr_check_padding(h,c);
+}
+
+/* Precompute the constants used by rsa_verify_mont from a Public Key */
+void rsa_mont_setup(char pub[],BIG n[],BIG *n0,BIG r2[])
+{
+	tr_convert(pub,n);
+	*n0=tr_mont_n0(n);
+	tr_mont_r2(n,*n0,r2);
+}
+
+/* Sliced RSA verification. s^EXPON mod n does not depend on the Message
+   Digest, so it can be worked out a piece at a time while the data is still
+   being received:
+   rsa_pow_start  - sets up the job from the precomputed Public Key and the
+                    purported Signature
+   rsa_pow_step   - does one Montgomery multiplication, returns 1 once the
+                    job is complete
+   rsa_pow_check  - finishes the job if need be, then compares with the
+                    padded Message Digest. Returns 1 if signature is correct,
+                    else 0
+*/
+
+void rsa_pow_start(rsa_pow_job *j,BIG n[],BIG n0,BIG r2[],char sig[])
+{
+	j->n=n;
+	j->n0=n0;
+	j->r2=r2;
+	j->step=0;
+	tr_convert(sig,j->s);
+}
+
+int rsa_pow_step(rsa_pow_job *j)
+{
+	if (j->step==0)
+		tr_montmul(j->s,j->r2,j->n,j->n0,j->c);  /* into Montgomery form */
+	else if (j->step<=MONT_SQUARINGS)
+		tr_montmul(j->c,j->c,j->n,j->n0,j->c);   /* square... */
+	else if (j->step==MONT_SQUARINGS+1)
+		tr_montmul(j->c,j->s,j->n,j->n0,j->c);   /* and multiply */
+	else return 1;
+
+	j->step++;
+	return (j->step>MONT_SQUARINGS+1);
+}
+
+int rsa_pow_check(char h[],rsa_pow_job *j)
+{
+	while (!rsa_pow_step(j)) ;
+	return tr_check_padding(h,j->c);
+}
+
+#endif
+
 
 #ifdef TR_TEST
 
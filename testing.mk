@@ -97,6 +97,28 @@ XAFLAGS += -D_SPECIAL_TEST=$(_SPECIAL_TEST)
 endif
 endif
 
+#  _BOOT_PROFILE==1:  Record boot phase timestamps in the communication area
+#  _BOOT_PROFILE!=1:  No boot phase profiling
+ifeq ($(_BOOT_PROFILE),1)
+XCFLAGS += -D_BOOT_PROFILE
+XAFLAGS += -D_BOOT_PROFILE
+endif
+
+#  _UNIPRO_WFI==1:  Sleep in WFI while waiting for UniPro events
+#  _UNIPRO_WFI!=1:  Busy-poll the UniPro status while waiting
+ifeq ($(_UNIPRO_WFI),1)
+XCFLAGS += -D_UNIPRO_WFI
+XAFLAGS += -D_UNIPRO_WFI
+endif
+
+#  _UNIPRO_RX_PLACEMENT==1:  Let protocols receive messages in place on TSB
+#                            (RX paused after the header, resumed elsewhere)
+#  _UNIPRO_RX_PLACEMENT!=1:  Receive whole messages into the CPort RX buffer
+ifeq ($(_UNIPRO_RX_PLACEMENT),1)
+XCFLAGS += -D_UNIPRO_RX_PLACEMENT
+XAFLAGS += -D_UNIPRO_RX_PLACEMENT
+endif
+
 #  _CLEAR_MIN_MEMORY==1:  Clear only the minimum of RAM at startup
 #  _CLEAR_MIN_MEMORY!=1:  Clear all of RAM at startup
 ifeq ($(_CLEAR_MIN_MEMORY),1)
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Host tool to precompute the Montgomery constants (crypto_public_key_mont)
+ * of the public keys in the public keys file it is linked with, so the
+ * target can skip the per-key setup when verifying signatures.
+ *
+ * Usage:
+ *   pubkey_mont          Write C source for public_keys_mont[] to stdout
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "crypto.h"
+
+#define MONTGOMERY
+#include "bootrom.c"
+
+typedef char ___limb_size_test[(sizeof(BIG) == sizeof(uint32_t) &&
+                                MODSIZE == RSA2048_PUBLIC_KEY_WORDS) ?
+                               1 : -1];
+
+static void compute_key_mont(const crypto_public_key *key,
+                             crypto_public_key_mont *mont) {
+    BIG n0;
+
+    memset(mont, 0, sizeof(*mont));
+    if (key->type != ALGORITHM_TYPE_RSA2048_SHA256) {
+        /* leave n0 at 0: nothing precomputed for this key */
+        return;
+    }
+
+    rsa_mont_setup((char *)key->key, mont->modulus, &n0, mont->r2);
+    mont->n0 = n0;
+}
+
+static void print_words(const char *name, const uint32_t *words) {
+    uint32_t i;
+
+    printf("        .%s = {", name);
+    for (i = 0; i < RSA2048_PUBLIC_KEY_WORDS; i++) {
+        printf("%s0x%08x%s", (i % 6) ? " " : "\n            ", words[i],
+               (i == RSA2048_PUBLIC_KEY_WORDS - 1) ? "" : ",");
+    }
+    printf("\n        }");
+}
+
+static int write_source(void) {
+    crypto_public_key_mont mont;
+    uint32_t k;
+
+    printf("/* Precomputed Montgomery constants for public_keys[] */\n");
+    printf("/* Automatically generated file ... DO NOT EDIT */\n\n");
+    printf("#include <stddef.h>\n");
+    printf("#include \"crypto.h\"\n\n");
+    printf("const crypto_public_key_mont public_keys_mont[] = {\n");
+    for (k = 0; k < number_of_public_keys; k++) {
+        compute_key_mont(&public_keys[k], &mont);
+        printf("    {\n");
+        printf("        /* %.*s */\n",
+               (int)sizeof(public_keys[k].key_name), public_keys[k].key_name);
+        printf("        .n0 = 0x%08x,\n", mont.n0);
+        print_words("modulus", mont.modulus);
+        printf(",\n");
+        print_words("r2", mont.r2);
+        printf("\n    },\n");
+    }
+    printf("};\n\n");
+    printf("const uint32_t number_of_public_keys_mont =\n");
+    printf("    sizeof(public_keys_mont)/sizeof(crypto_public_key_mont);\n");
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    return write_source() ? 1 : 0;
+}